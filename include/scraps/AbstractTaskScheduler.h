@@ -17,12 +17,18 @@
 
 #include <scraps/config.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 namespace scraps {
 
@@ -61,12 +67,49 @@ public:
     std::future<typename std::result_of<typename std::decay<F>::type(typename std::decay<Args>::type...)>::type>
     asyncAt(const TaskScope& scope, const std::chrono::steady_clock::time_point& t, F&& f, Args&&... args);
 
+    /**
+    * Schedules a function without providing a future for its result. If the bound function is
+    * small enough, this doesn't allocate once the calling thread has warmed up, so it's preferable
+    * to async on hot paths.
+    */
+    template<class F, class... Args>
+    void post(F&& f, Args&&... args);
+
+    template<class F, class... Args>
+    void postAfter(const std::chrono::steady_clock::duration& d, F&& f, Args&&... args);
+
+    template<class F, class... Args>
+    void postAt(const std::chrono::steady_clock::time_point& t, F&& f, Args&&... args);
+
+    /**
+    * Schedules each function in the range. This is equivalent to invoking async for each one, but
+    * schedulers can insert them all at once, which is much cheaper for large batches.
+    *
+    * @return a future for each function, in the same order
+    */
+    template<class Iterator>
+    std::vector<std::future<typename std::result_of<typename std::decay<decltype(*std::declval<Iterator>())>::type()>::type>>
+    asyncBatch(Iterator first, Iterator last);
+
+    /**
+    * Like asyncBatch, but without futures. See post.
+    */
+    template<class Iterator>
+    void postBatch(Iterator first, Iterator last);
+
 protected:
     struct Task;
     template<class> struct TaskImpl;
+    template<class> struct PostedTask;
+    struct PostedTaskStorage;
     struct TaskComparer;
     struct TaskScopeImpl;
 
+    /**
+    * Adds tasks to a heap ordered by TaskComparer, leaving tasks empty.
+    */
+    static void _heapInsert(std::vector<std::unique_ptr<Task>>* heap, std::vector<std::unique_ptr<Task>>* tasks);
+
 private:
     template<class F, class... Args>
     std::packaged_task<typename std::result_of<typename std::decay<F>::type(typename std::decay<Args>::type...)>::type()>
@@ -77,6 +120,11 @@ private:
     _makeTask(std::chrono::steady_clock::time_point t, std::packaged_task<R(Args...)>&& task, std::shared_ptr<TaskScopeImpl> scope = {});
 
     virtual void _async(std::unique_ptr<Task> task) = 0;
+
+    /**
+    * Schedules several tasks. By default, this just invokes _async for each one.
+    */
+    virtual void _asyncBatch(std::vector<std::unique_ptr<Task>> tasks);
 };
 
 struct AbstractTaskScheduler::TaskScopeImpl {
@@ -109,6 +157,14 @@ struct AbstractTaskScheduler::Task {
     virtual void operator()() = 0;
     virtual void reset() = 0;
 
+    /**
+    * Returns true if the task can run now. Tasks without a delay are scheduled for the minimum
+    * time point, so this only needs to read the clock for delayed tasks.
+    */
+    bool isDue() const {
+        return time == std::chrono::steady_clock::time_point::min() || time <= std::chrono::steady_clock::now();
+    }
+
     std::chrono::steady_clock::time_point time;
 };
 
@@ -157,6 +213,47 @@ struct AbstractTaskScheduler::TaskImpl<R(Args...)> : public AbstractTaskSchedule
     std::weak_ptr<TaskScopeImpl>   weakScope;
 };
 
+/**
+* Recycles fixed-size blocks for posted tasks. Each thread caches freed blocks and exchanges them
+* with a shared depot in batches, so allocating a block is usually just popping a list.
+*/
+struct AbstractTaskScheduler::PostedTaskStorage {
+    static constexpr size_t kBlockSize = 128;
+
+    static void* allocate();
+    static void deallocate(void* block);
+};
+
+template<class F>
+struct AbstractTaskScheduler::PostedTask : public AbstractTaskScheduler::Task {
+    PostedTask(std::chrono::steady_clock::time_point time, F f) : Task(time), f{std::move(f)} {}
+
+    virtual void operator()() override { f(); }
+    virtual void reset() override {}
+
+    // blocks are only guaranteed the fundamental alignment, so over-aligned tasks go to the aligned
+    // overloads below instead
+    static constexpr bool kIsPooled = sizeof(PostedTask) <= PostedTaskStorage::kBlockSize
+                                   && alignof(PostedTask) <= alignof(std::max_align_t);
+
+    static void* operator new(size_t size) {
+        return kIsPooled ? PostedTaskStorage::allocate() : ::operator new(size);
+    }
+
+    static void operator delete(void* p) {
+        if (kIsPooled) {
+            PostedTaskStorage::deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    static void* operator new(size_t size, std::align_val_t alignment) { return ::operator new(size, alignment); }
+    static void operator delete(void* p, std::align_val_t alignment) { ::operator delete(p, alignment); }
+
+    F f;
+};
+
 struct AbstractTaskScheduler::TaskComparer {
     bool operator()(const std::unique_ptr<Task>& left, const std::unique_ptr<Task>& right) const {
         return right->time < left->time;
@@ -180,13 +277,13 @@ inline void AbstractTaskScheduler::TaskScopeImpl::reset() {
 template<class F, class... Args>
 std::future<typename std::result_of<typename std::decay<F>::type(typename std::decay<Args>::type...)>::type>
 AbstractTaskScheduler::async(F&& f, Args&&... args) {
-    return asyncAt(std::chrono::steady_clock::now(), std::forward<F>(f), std::forward<Args>(args)...);
+    return asyncAt(std::chrono::steady_clock::time_point::min(), std::forward<F>(f), std::forward<Args>(args)...);
 }
 
 template<class F, class... Args>
 std::future<typename std::result_of<typename std::decay<F>::type(typename std::decay<Args>::type...)>::type>
 AbstractTaskScheduler::async(const TaskScope& scope, F&& f, Args&&... args) {
-    return asyncAt(scope, std::chrono::steady_clock::now(), std::forward<F>(f), std::forward<Args>(args)...);
+    return asyncAt(scope, std::chrono::steady_clock::time_point::min(), std::forward<F>(f), std::forward<Args>(args)...);
 }
 
 template<class F, class... Args>
@@ -222,6 +319,49 @@ AbstractTaskScheduler::asyncAt(const TaskScope& scope, const std::chrono::steady
     return future;
 }
 
+template<class F, class... Args>
+void AbstractTaskScheduler::post(F&& f, Args&&... args) {
+    postAt(std::chrono::steady_clock::time_point::min(), std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+void AbstractTaskScheduler::postAfter(const std::chrono::steady_clock::duration& d, F&& f, Args&&... args) {
+    postAt(std::chrono::steady_clock::now() + d, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+void AbstractTaskScheduler::postAt(const std::chrono::steady_clock::time_point& t, F&& f, Args&&... args) {
+    auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+    _async(std::unique_ptr<Task>(new PostedTask<decltype(bound)>(t, std::move(bound))));
+}
+
+template<class Iterator>
+std::vector<std::future<typename std::result_of<typename std::decay<decltype(*std::declval<Iterator>())>::type()>::type>>
+AbstractTaskScheduler::asyncBatch(Iterator first, Iterator last) {
+    using ResultType = typename std::result_of<typename std::decay<decltype(*std::declval<Iterator>())>::type()>::type;
+
+    std::vector<std::future<ResultType>> futures;
+    std::vector<std::unique_ptr<Task>> tasks;
+    for (; first != last; ++first) {
+        std::packaged_task<ResultType()> task{*first};
+        futures.emplace_back(task.get_future());
+        tasks.emplace_back(_makeTask(std::chrono::steady_clock::time_point::min(), std::move(task)));
+    }
+    _asyncBatch(std::move(tasks));
+    return futures;
+}
+
+template<class Iterator>
+void AbstractTaskScheduler::postBatch(Iterator first, Iterator last) {
+    using F = typename std::decay<decltype(*std::declval<Iterator>())>::type;
+
+    std::vector<std::unique_ptr<Task>> tasks;
+    for (; first != last; ++first) {
+        tasks.emplace_back(new PostedTask<F>(std::chrono::steady_clock::time_point::min(), *first));
+    }
+    _asyncBatch(std::move(tasks));
+}
+
 template<class F, class... Args>
 std::packaged_task<typename std::result_of<typename std::decay<F>::type(typename std::decay<Args>::type...)>::type()>
 AbstractTaskScheduler::_makePackagedTask(F&& f, Args&&... args) {
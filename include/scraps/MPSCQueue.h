@@ -0,0 +1,98 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <stdts/optional.h>
+
+#include <atomic>
+
+namespace scraps {
+
+/**
+* An unbounded, lock-free, multi-producer single-consumer FIFO queue.
+*
+* Pushing is wait-free: a single atomic exchange. Popping is lock-free, but a pop may briefly
+* fail to see an element whose push is still in progress. In that case empty() will return
+* false even though pop() does.
+*
+* push() is thread-safe. pop() and empty() must only be invoked by the consumer.
+*/
+template <typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() : _head{new Node}, _tail{_head.load()} {}
+
+    ~MPSCQueue() {
+        while (_tail) {
+            auto next = _tail->next.load(std::memory_order_relaxed);
+            delete _tail;
+            _tail = next;
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    /**
+    * Pushes a value onto the queue. Pushes from a single thread are popped in the order they
+    * were pushed.
+    */
+    void push(T value) {
+        auto node = new Node;
+        node->value.emplace(std::move(value));
+        // sequentially consistent so that consumers can reliably pair empty() with a flag that
+        // producers check after pushing (e.g. to decide whether the consumer needs to be woken)
+        auto prev = _head.exchange(node);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+    * Pops the next value off of the queue.
+    *
+    * @return false if there was nothing to pop
+    */
+    bool pop(T* value) {
+        auto next = _tail->next.load(std::memory_order_acquire);
+        if (!next) { return false; }
+
+        // next becomes the new sentinel
+        *value = std::move(*next->value);
+        next->value = stdts::nullopt;
+        delete _tail;
+        _tail = next;
+        return true;
+    }
+
+    /**
+    * Returns true if nothing has been pushed since the last element was popped.
+    */
+    bool empty() const {
+        return _head.load() == _tail;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        stdts::optional<T> value;
+    };
+
+    std::atomic<Node*> _head;
+    Node* _tail;
+};
+
+} // namespace scraps
@@ -17,23 +17,82 @@
 
 #include <scraps/config.h>
 
+#include <scraps/MPSCQueue.h>
+#include <scraps/TimerWheel.h>
+#include <scraps/poller/PollerInterface.h>
+
 #include <functional>
-#include <mutex>
-#include <unordered_map>
-#include <unordered_set>
 
 #include <poll.h>
 
 #include <atomic>
-#include <queue>
 
 namespace scraps {
 
 /**
-* Thread-safe.
+* Thread-safe. Functions and file descriptor changes from other threads are passed to the loop via
+* a lock-free queue, and the loop is only signaled when it's actually blocked waiting for events.
 */
 class RunLoop {
+    struct Timer;
+
 public:
+    /**
+    * Refers to a function scheduled via async. Handles are cheap to copy and can simply be
+    * discarded if the function never needs to be cancelled. A handle must not be used after its
+    * run loop is destroyed.
+    */
+    class TimerHandle {
+    public:
+        TimerHandle() = default;
+
+        /**
+        * Prevents the function from being invoked and destroys it immediately. Has no effect if the
+        * function has already been invoked or cancelled.
+        *
+        * @return true if the function was cancelled
+        */
+        bool cancel();
+
+        /**
+        * Changes the delay of the function, measured from now. Has no effect if the function has
+        * already been invoked or cancelled. The change is applied by the loop asynchronously, so if
+        * the original deadline is imminent, the function may still be invoked at that time.
+        *
+        * @return true if the function was rescheduled
+        */
+        bool reschedule(std::chrono::steady_clock::duration delay);
+
+    private:
+        friend class RunLoop;
+
+        TimerHandle(RunLoop* runLoop, std::shared_ptr<Timer> timer) : _runLoop{runLoop}, _timer{std::move(timer)} {}
+
+        RunLoop* _runLoop = nullptr;
+        std::shared_ptr<Timer> _timer;
+    };
+
+    static constexpr std::chrono::steady_clock::duration kDefaultTimerResolution = std::chrono::milliseconds(1);
+
+    /**
+    * Creates a run loop using the most scalable poller available on the current platform.
+    */
+    RunLoop();
+
+    /**
+    * Creates a run loop with a custom timer resolution. Delayed functions are invoked within one
+    * resolution of their deadline. A high resolution (e.g. 50 microseconds) is useful for pacing
+    * output, but causes more frequent wake-ups when many timers are pending.
+    */
+    explicit RunLoop(std::chrono::steady_clock::duration timerResolution);
+
+    /**
+    * Creates a run loop using the given poller (e.g. a poller::IOUringPoller).
+    */
+    explicit RunLoop(std::unique_ptr<poller::PollerInterface> poller, std::chrono::steady_clock::duration timerResolution = kDefaultTimerResolution);
+
+    ~RunLoop();
+
     /**
     * Runs the poll loop. Blocks until an error occurs or cancel is invoked.
     */
@@ -45,9 +104,10 @@ public:
     void setEventHandler(std::function<void(int fd, short events)> eventHandler);
 
     /**
-    * Sets a function to be invoked by the poll loop after a specified delay.
+    * Sets a function to be invoked by the poll loop after a specified delay. Scheduling and
+    * cancellation are O(1).
     */
-    void async(std::function<void()> func, std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    TimerHandle async(std::function<void()> func, std::chrono::steady_clock::duration delay = std::chrono::steady_clock::duration::zero());
 
     /**
     * Finish running any outstanding functions left in the queue. This should only be needed
@@ -79,43 +139,49 @@ public:
     void reset();
 
 private:
-    std::mutex _mutex;
+    /**
+    * A request from any thread, to be applied by the loop.
+    */
+    struct Submission {
+        enum class Type {
+            kAsync,
+            kReschedule,
+            kCancel,
+            kAdd,
+            kRemove,
+        };
+
+        Type type = Type::kAsync;
+        std::shared_ptr<Timer> timer;
+        std::chrono::steady_clock::time_point deadline;
+        int fd = -1;
+        short events = 0;
+    };
 
-    std::vector<struct pollfd> _pollDescriptors;
+    std::unique_ptr<poller::PollerInterface> _poller;
+    std::vector<poller::Event> _events;
 
     std::function<void(int fd, short events)> _eventHandler;
 
-    std::unordered_map<int, short> _pendingAdditions;
-    std::unordered_set<int> _pendingRemovals;
-
-    struct AsyncFunction {
-        AsyncFunction(std::function<void()> func, std::chrono::steady_clock::time_point time, uint64_t order)
-            : func{std::move(func)}
-            , time{time}
-            , order{order}
-        {}
-
-        std::function<void()> func;
-        std::chrono::steady_clock::time_point time;
-        uint64_t order = 0;
+    MPSCQueue<Submission> _submissions;
 
-        bool operator<(const AsyncFunction& other) const {
-            return time == other.time ? (order > other.order) : (time > other.time);
-        }
-    };
-
-    std::priority_queue<AsyncFunction> _asyncFunctions;
-    uint64_t _asyncFunctionCounter = 0;
+    // only accessed by the loop's thread, or by flush and reset while the loop isn't running
+    TimerWheel<std::shared_ptr<Timer>> _timers;
+    std::vector<std::shared_ptr<Timer>> _expiredTimers;
 
     std::atomic<bool> _isCancelled{false};
 
-    std::mutex _pipeMutex;
-    enum { kWakeUpPipeOutput, kWakeUpPipeInput };
-    int _wakeUpPipe[2]{-1, -1};
-    std::atomic<bool> _shouldWake{false};
+    // an eventfd where available, or a pipe otherwise
+    enum { kDoorbellOutput, kDoorbellInput };
+    int _doorbell[2]{-1, -1};
+    std::atomic<bool> _isBlocked{false};
+
+    static std::chrono::steady_clock::time_point _deadline(std::chrono::steady_clock::duration delay);
 
+    void _submit(Submission submission);
     void _wakeUp();
-    void _processPendingAdditionsAndRemovals();
+    void _processSubmissions();
+    bool _invokeExpiredTimers(std::chrono::steady_clock::time_point now);
 };
 
 } // namespace scraps
@@ -0,0 +1,94 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <scraps/RunLoop.h>
+
+#include <stdts/optional.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scraps {
+
+/**
+* A fixed set of run loops, each run by its own thread. Work is typically sharded across the loops
+* by some key (e.g. a file descriptor or connection id) so that everything associated with that
+* key is handled by a single thread.
+*
+* Each loop has a single event handler, so a group should only be used by one service at a time.
+*
+* Thread-safe, except for start, stop, and wait, which should be invoked by the group's owner.
+*/
+class RunLoopGroup {
+public:
+    /**
+    * @param size the number of loops. if zero, one loop is created per hardware thread
+    * @param name used to name the loops' threads
+    * @param pinThreads if true, each thread is restricted to a single CPU where supported
+    */
+    explicit RunLoopGroup(size_t size = 1, std::string name = "RunLoopGroup", bool pinThreads = false);
+    ~RunLoopGroup();
+
+    size_t size() const { return _loops.size(); }
+
+    RunLoop& loop(size_t index) { return *_loops[index]; }
+
+    /**
+    * Returns the index of the loop responsible for the given key.
+    */
+    size_t shard(uint64_t key) const { return key % _loops.size(); }
+
+    /**
+    * Resets and runs every loop on its own thread.
+    *
+    * @param onStarted if given, invoked on each loop's thread just before the loop starts running
+    * @param onStopped if given, invoked on each loop's thread after the loop stops running, but
+    *                  before remaining functions are flushed. this is a good place to clean up
+    *                  anything owned by the loop
+    */
+    void start(std::function<void(size_t index)> onStarted = std::function<void(size_t)>(),
+               std::function<void(size_t index)> onStopped = std::function<void(size_t)>());
+
+    /**
+    * Stops every loop. Use wait() to wait for them to fully stop.
+    */
+    void stop();
+
+    /**
+    * Blocks until every loop is fully stopped.
+    */
+    void wait();
+
+    /**
+    * Returns the index of the loop run by the current thread, if the current thread belongs to
+    * the group.
+    */
+    stdts::optional<size_t> currentIndex() const;
+
+    bool isCurrentThread() const { return static_cast<bool>(currentIndex()); }
+
+private:
+    const std::string _name;
+    const bool _pinThreads;
+    std::vector<std::unique_ptr<RunLoop>> _loops;
+    std::vector<std::thread> _threads;
+};
+
+} // namespace scraps
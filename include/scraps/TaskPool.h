@@ -0,0 +1,102 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <scraps/AbstractTaskScheduler.h>
+
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scraps {
+
+/**
+* Runs tasks on a fixed set of worker threads.
+*
+* Each worker has its own deque. Tasks scheduled by a worker go onto that worker's deque, and
+* tasks scheduled by other threads are distributed round-robin. Workers run their own tasks
+* newest-first and, when they run out, steal the oldest tasks from other workers. Tasks
+* scheduled for the future are kept in a single shared heap until they're due.
+*
+* Ready tasks are not guaranteed to run in any particular order.
+*/
+class TaskPool : public AbstractTaskScheduler {
+public:
+    using TaskScope = AbstractTaskScheduler::TaskScope;
+
+    /**
+    * @param size the number of worker threads. if zero, one thread is created per hardware thread
+    * @param threadName used to name the worker threads
+    */
+    explicit TaskPool(size_t size = 0, const std::string& threadName = "TaskPool");
+    TaskPool(const TaskPool&) = delete;
+    TaskPool(TaskPool&&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+    TaskPool& operator=(TaskPool&&) = delete;
+    ~TaskPool();
+
+    size_t size() const { return _workers.size(); }
+
+    /**
+    * Waits for running tasks to complete, then stops the workers. Tasks that haven't started are
+    * destroyed and subsequently scheduled tasks are ignored.
+    */
+    void cancelAndJoin();
+
+private:
+    struct Worker {
+        std::mutex                        mutex;
+        std::deque<std::unique_ptr<Task>> tasks;
+    };
+
+    virtual void _async(std::unique_ptr<Task> task) override;
+    virtual void _asyncBatch(std::vector<std::unique_ptr<Task>> tasks) override;
+    void _run(size_t index);
+
+    void _push(size_t index, std::unique_ptr<Task> task);
+    std::unique_ptr<Task> _pop(size_t index);
+    void _idle(size_t index);
+
+    /**
+    * Moves due tasks from the timer heap onto the given worker's deque. _mutex must be held.
+    *
+    * @return the number of tasks moved
+    */
+    size_t _promoteTimers(size_t index, std::chrono::steady_clock::time_point now);
+    void _updateNextTimer();
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t>                  _nextWorker{0};
+    std::atomic<size_t>                  _queued{0};
+    std::atomic<size_t>                  _sleeping{0};
+    std::atomic<bool>                    _exit{false};
+
+    // the earliest timer, so busy workers can cheaply check whether any are due
+    std::atomic<std::chrono::steady_clock::rep> _nextTimer;
+
+    std::mutex                         _mutex;
+    std::condition_variable            _condVar;
+    std::vector<std::unique_ptr<Task>> _timers;
+    bool                               _hasTimerWaiter = false;
+
+    std::vector<std::thread> _threads;
+};
+
+} // namespace scraps
@@ -19,6 +19,7 @@
 
 #include <scraps/AbstractTaskScheduler.h>
 
+#include <deque>
 #include <vector>
 
 namespace scraps {
@@ -43,9 +44,11 @@ public:
 
 private:
     virtual void _async(std::unique_ptr<Task> task) override;
+    virtual void _asyncBatch(std::vector<std::unique_ptr<Task>> tasks) override;
 
     std::mutex                         _mutex;
-    std::vector<std::unique_ptr<Task>> _tasks;
+    std::deque<std::unique_ptr<Task>>  _ready;
+    std::vector<std::unique_ptr<Task>> _timers;
 };
 
 } // namespace scraps
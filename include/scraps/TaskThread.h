@@ -20,6 +20,7 @@
 #include <scraps/AbstractTaskScheduler.h>
 
 #include <condition_variable>
+#include <deque>
 #include <vector>
 #include <algorithm>
 
@@ -40,10 +41,12 @@ public:
 
 private:
     virtual void _async(std::unique_ptr<Task> task) override;
+    virtual void _asyncBatch(std::vector<std::unique_ptr<Task>> tasks) override;
     void _run();
 
     std::mutex                         _mutex;
-    std::vector<std::unique_ptr<Task>> _tasks;
+    std::deque<std::unique_ptr<Task>>  _ready;
+    std::vector<std::unique_ptr<Task>> _timers;
     std::condition_variable            _condVar;
     bool                               _exit = false;
     std::thread                        _thread;
@@ -0,0 +1,440 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <stdts/optional.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace scraps {
+
+/**
+* A hierarchical timing wheel. Insertion and erasure are O(1), and expiration is O(expired
+* elements) plus a constant amount of work per level.
+*
+* Time is divided into ticks of a fixed resolution. Elements never expire before their deadline,
+* but may expire up to one tick after it. Elements that expire in the same tick are returned in
+* insertion order.
+*
+* Elements are stored in a pool, so inserting doesn't allocate once the pool has grown to
+* accommodate the wheel's peak size.
+*
+* This class is not thread-safe.
+*/
+template <typename T>
+class TimerWheel {
+public:
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Duration  = Clock::duration;
+
+    /**
+    * Identifies an element in the wheel. Ids are never reused, so stale ids can safely be used
+    * with erase.
+    */
+    using Id = uint64_t;
+
+    static constexpr Id kInvalidId = 0;
+
+    explicit TimerWheel(Duration resolution = std::chrono::milliseconds(1), TimePoint start = Clock::now())
+        : _resolution{resolution}
+        , _start{start}
+    {
+        _heads.fill(kNil);
+        _tails.fill(kNil);
+        for (auto& bitmap : _occupied) {
+            bitmap.fill(0);
+        }
+    }
+
+    /**
+    * Inserts an element which will expire at the given deadline.
+    */
+    Id insert(TimePoint deadline, T value);
+
+    /**
+    * Erases an element if it hasn't already expired or been erased.
+    *
+    * @param value if given, the element's value is moved here instead of being destroyed
+    * @return true if the element was erased
+    */
+    bool erase(Id id, T* value = nullptr);
+
+    /**
+    * Changes the deadline of an element if it hasn't already expired or been erased.
+    *
+    * @return true if the element was rescheduled
+    */
+    bool reschedule(Id id, TimePoint deadline);
+
+    /**
+    * Indicates whether or not the element is in the wheel.
+    */
+    bool contains(Id id) const { return _find(id) != kNil; }
+
+    /**
+    * Advances the wheel to the given time, moving the values of all expired elements to expired.
+    */
+    void expire(TimePoint now, std::vector<T>* expired);
+
+    /**
+    * Returns the time at which the wheel next needs to be advanced, or nothing if the wheel is
+    * empty. This is never later than the tick in which the next element expires, but may be
+    * earlier if elements need to be moved between levels.
+    */
+    stdts::optional<TimePoint> nextExpiration() const;
+
+    size_t size() const { return _size; }
+    bool empty() const { return !_size; }
+
+    /**
+    * Removes all elements.
+    *
+    * @param values if given, the elements' values are moved here instead of being destroyed
+    */
+    void clear(std::vector<T>* values = nullptr);
+
+private:
+    static constexpr size_t kLevels    = 4;
+    static constexpr size_t kSlotBits  = 8;
+    static constexpr size_t kSlots     = 1 << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlots - 1;
+
+    // in addition to the wheel slots, there's a list for elements that are already due and a
+    // list for elements beyond the range of the top level
+    static constexpr size_t kDueList      = kLevels * kSlots;
+    static constexpr size_t kOverflowList = kDueList + 1;
+    static constexpr size_t kLists        = kOverflowList + 1;
+
+    static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        stdts::optional<T> value;
+        int64_t  tick       = 0;
+        uint32_t generation = 0;
+        uint32_t list       = 0;
+        uint32_t prev       = kNil;
+        uint32_t next       = kNil;
+    };
+
+    const Duration  _resolution;
+    const TimePoint _start;
+    int64_t         _currentTick = 0;
+    size_t          _size = 0;
+
+    std::vector<Node>               _nodes;
+    uint32_t                        _freeList = kNil;
+    std::array<uint32_t, kLists>    _heads;
+    std::array<uint32_t, kLists>    _tails;
+    std::array<std::array<uint64_t, kSlots / 64>, kLevels> _occupied;
+
+    static Id _id(uint32_t index, uint32_t generation) { return (static_cast<Id>(generation) << 32) | index; }
+
+    uint32_t _find(Id id) const;
+    TimePoint _tickTime(int64_t tick) const { return _start + _resolution * tick; }
+    int64_t _deadlineTick(TimePoint deadline) const;
+
+    void _place(uint32_t index);
+    void _link(uint32_t index, uint32_t list);
+    void _unlink(uint32_t index);
+    void _cascade(uint32_t list);
+    void _drain(uint32_t list, std::vector<T>* expired);
+
+    stdts::optional<int64_t> _nextEventTick() const;
+    stdts::optional<int64_t> _nextOccupiedSlot(size_t level, size_t after) const;
+};
+
+template <typename T> constexpr typename TimerWheel<T>::Id TimerWheel<T>::kInvalidId;
+
+template <typename T>
+typename TimerWheel<T>::Id TimerWheel<T>::insert(TimePoint deadline, T value) {
+    uint32_t index;
+    if (_freeList != kNil) {
+        index = _freeList;
+        _freeList = _nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    auto& node = _nodes[index];
+    node.value.emplace(std::move(value));
+    node.tick = _deadlineTick(deadline);
+    if (!++node.generation) {
+        // skip generation 0 so that kInvalidId is never produced
+        ++node.generation;
+    }
+
+    _place(index);
+    ++_size;
+    return _id(index, node.generation);
+}
+
+template <typename T>
+bool TimerWheel<T>::erase(Id id, T* value) {
+    auto index = _find(id);
+    if (index == kNil) { return false; }
+
+    _unlink(index);
+
+    auto& node = _nodes[index];
+    if (value) {
+        *value = std::move(*node.value);
+    }
+    node.value = stdts::nullopt;
+    node.next = _freeList;
+    _freeList = index;
+    --_size;
+    return true;
+}
+
+template <typename T>
+bool TimerWheel<T>::reschedule(Id id, TimePoint deadline) {
+    auto index = _find(id);
+    if (index == kNil) { return false; }
+
+    _unlink(index);
+    _nodes[index].tick = _deadlineTick(deadline);
+    _place(index);
+    return true;
+}
+
+template <typename T>
+void TimerWheel<T>::expire(TimePoint now, std::vector<T>* expired) {
+    if (now < _start) { return; }
+    auto target = static_cast<int64_t>((now - _start) / _resolution);
+
+    _drain(kDueList, expired);
+
+    while (_currentTick < target) {
+        auto next = _nextEventTick();
+        if (!next || *next > target) {
+            _currentTick = target;
+            break;
+        }
+        _currentTick = *next;
+
+        // cascade higher levels down, starting with the highest so that their elements can
+        // continue down through the lower levels
+        if (!(_currentTick & ((int64_t{1} << (kSlotBits * kLevels)) - 1))) {
+            _cascade(kOverflowList);
+        }
+        for (size_t level = kLevels - 1; level > 0; --level) {
+            if (!(_currentTick & ((int64_t{1} << (kSlotBits * level)) - 1))) {
+                _cascade(level * kSlots + ((_currentTick >> (kSlotBits * level)) & kSlotMask));
+            }
+        }
+
+        _drain(_currentTick & kSlotMask, expired);
+        _drain(kDueList, expired);
+    }
+}
+
+template <typename T>
+stdts::optional<typename TimerWheel<T>::TimePoint> TimerWheel<T>::nextExpiration() const {
+    if (_heads[kDueList] != kNil) {
+        return _tickTime(_currentTick);
+    }
+    auto tick = _nextEventTick();
+    if (!tick) { return {}; }
+    return _tickTime(*tick);
+}
+
+template <typename T>
+void TimerWheel<T>::clear(std::vector<T>* values) {
+    // keep the nodes so that their generations, and therefore the ids they produce, keep advancing
+    _freeList = kNil;
+    for (auto i = static_cast<uint32_t>(_nodes.size()); i > 0; --i) {
+        auto& node = _nodes[i - 1];
+        if (values && node.value) {
+            values->emplace_back(std::move(*node.value));
+        }
+        node.value = stdts::nullopt;
+        node.prev = kNil;
+        node.next = _freeList;
+        _freeList = i - 1;
+    }
+    _heads.fill(kNil);
+    _tails.fill(kNil);
+    for (auto& bitmap : _occupied) {
+        bitmap.fill(0);
+    }
+    _size = 0;
+}
+
+template <typename T>
+uint32_t TimerWheel<T>::_find(Id id) const {
+    auto index = static_cast<uint32_t>(id);
+    if (index >= _nodes.size()) { return kNil; }
+    auto& node = _nodes[index];
+    if (!node.value || node.generation != static_cast<uint32_t>(id >> 32)) { return kNil; }
+    return index;
+}
+
+template <typename T>
+int64_t TimerWheel<T>::_deadlineTick(TimePoint deadline) const {
+    // round up so that elements never expire early
+    auto current = _tickTime(_currentTick);
+    if (deadline <= current) {
+        return _currentTick;
+    }
+    auto ticks = (deadline - current + _resolution - Duration{1}) / _resolution;
+    if (ticks > std::numeric_limits<int64_t>::max() - _currentTick) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return _currentTick + ticks;
+}
+
+template <typename T>
+void TimerWheel<T>::_place(uint32_t index) {
+    auto tick = _nodes[index].tick;
+
+    if (tick <= _currentTick) {
+        _link(index, kDueList);
+        return;
+    }
+
+    // an element belongs to the lowest level at which its tick shares all higher bits with the
+    // current tick. this guarantees that its slot is ahead of the level's current position
+    for (size_t level = 0; level < kLevels; ++level) {
+        auto shift = kSlotBits * (level + 1);
+        if ((tick >> shift) == (_currentTick >> shift)) {
+            _link(index, level * kSlots + ((tick >> (kSlotBits * level)) & kSlotMask));
+            return;
+        }
+    }
+
+    _link(index, kOverflowList);
+}
+
+template <typename T>
+void TimerWheel<T>::_link(uint32_t index, uint32_t list) {
+    auto& node = _nodes[index];
+    node.list = list;
+    node.next = kNil;
+    node.prev = _tails[list];
+
+    if (node.prev == kNil) {
+        _heads[list] = index;
+    } else {
+        _nodes[node.prev].next = index;
+    }
+    _tails[list] = index;
+
+    if (list < kDueList) {
+        auto slot = list % kSlots;
+        _occupied[list / kSlots][slot / 64] |= uint64_t{1} << (slot % 64);
+    }
+}
+
+template <typename T>
+void TimerWheel<T>::_unlink(uint32_t index) {
+    auto& node = _nodes[index];
+    auto list = node.list;
+
+    if (node.prev == kNil) {
+        _heads[list] = node.next;
+    } else {
+        _nodes[node.prev].next = node.next;
+    }
+
+    if (node.next == kNil) {
+        _tails[list] = node.prev;
+    } else {
+        _nodes[node.next].prev = node.prev;
+    }
+
+    node.prev = node.next = kNil;
+
+    if (list < kDueList && _heads[list] == kNil) {
+        auto slot = list % kSlots;
+        _occupied[list / kSlots][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    }
+}
+
+template <typename T>
+void TimerWheel<T>::_cascade(uint32_t list) {
+    auto index = _heads[list];
+    while (index != kNil) {
+        auto next = _nodes[index].next;
+        _unlink(index);
+        _place(index);
+        index = next;
+    }
+}
+
+template <typename T>
+void TimerWheel<T>::_drain(uint32_t list, std::vector<T>* expired) {
+    while (_heads[list] != kNil) {
+        auto index = _heads[list];
+        _unlink(index);
+
+        auto& node = _nodes[index];
+        expired->emplace_back(std::move(*node.value));
+        node.value = stdts::nullopt;
+        node.next = _freeList;
+        _freeList = index;
+        --_size;
+    }
+}
+
+template <typename T>
+stdts::optional<int64_t> TimerWheel<T>::_nextEventTick() const {
+    // the next event is the nearest occupied slot, where a slot in a higher level is reached
+    // when the level below it wraps around
+    stdts::optional<int64_t> ret;
+
+    for (size_t level = 0; level < kLevels; ++level) {
+        auto shift = kSlotBits * level;
+        auto slot = _nextOccupiedSlot(level, (_currentTick >> shift) & kSlotMask);
+        if (!slot) { continue; }
+
+        auto rotation = (_currentTick >> (shift + kSlotBits)) << (shift + kSlotBits);
+        auto tick = rotation + (*slot << shift);
+        if (!ret || tick < *ret) {
+            ret = tick;
+        }
+    }
+
+    if (!ret && _heads[kOverflowList] != kNil) {
+        auto shift = kSlotBits * kLevels;
+        ret = ((_currentTick >> shift) + 1) << shift;
+    }
+
+    return ret;
+}
+
+template <typename T>
+stdts::optional<int64_t> TimerWheel<T>::_nextOccupiedSlot(size_t level, size_t after) const {
+    auto& bitmap = _occupied[level];
+    auto slot = after + 1;
+    while (slot < kSlots) {
+        auto word = bitmap[slot / 64] >> (slot % 64);
+        if (word) {
+            return slot + __builtin_ctzll(word);
+        }
+        slot = (slot / 64 + 1) * 64;
+    }
+    return {};
+}
+
+} // namespace scraps
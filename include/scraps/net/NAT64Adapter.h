@@ -41,6 +41,7 @@ public:
 
     void setReceiver(std::weak_ptr<UDPReceiver> receiver);
 
+    using UDPSender::send;
     virtual bool send(const Endpoint& destination, const void* data, size_t length) override;
 
     virtual void receiveUDP(const net::Endpoint& sender, const void* data, size_t length) override;
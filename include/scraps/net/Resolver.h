@@ -0,0 +1,84 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <scraps/TaskPool.h>
+#include <scraps/net/Address.h>
+
+#include <stdts/optional.h>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scraps::net {
+
+/**
+* Resolves hosts on a small pool of threads so that callers (e.g. run loops) never block on DNS.
+*
+* Successful results are cached for a fixed time-to-live, since the system resolver doesn't
+* expose record TTLs.
+*
+* Thread-safe.
+*/
+class Resolver {
+public:
+    using TaskScope = AbstractTaskScheduler::TaskScope;
+
+    static constexpr std::chrono::steady_clock::duration kDefaultTTL = std::chrono::seconds(60);
+    static constexpr size_t kDefaultMaxCacheEntries = 1024;
+
+    explicit Resolver(size_t threads = 2, std::chrono::steady_clock::duration ttl = kDefaultTTL, size_t maxCacheEntries = kDefaultMaxCacheEntries);
+
+    /**
+    * Resolves the host, then invokes the callback with the results, which are empty on failure.
+    *
+    * If the host is cached, the callback is invoked immediately by the calling thread. Otherwise
+    * it's invoked by one of the resolver's threads, unless the scope is ended first. Ending the
+    * scope blocks until any callback that's already running returns.
+    */
+    void resolve(const TaskScope& scope, const std::string& host, std::function<void(std::vector<Address>)> callback);
+
+    /**
+    * Returns the cached addresses for the host, if there are any that haven't expired.
+    */
+    stdts::optional<std::vector<Address>> cached(const std::string& host);
+
+    void clearCache();
+
+private:
+    struct CacheEntry {
+        std::vector<Address> addresses;
+        std::chrono::steady_clock::time_point expiration;
+    };
+
+    const std::chrono::steady_clock::duration _ttl;
+    const size_t _maxCacheEntries;
+
+    std::mutex _mutex;
+    std::unordered_map<std::string, CacheEntry> _cache;
+
+    TaskPool _pool;
+
+    void _insert(const std::string& host, std::vector<Address> addresses);
+};
+
+} // namespace scraps::net
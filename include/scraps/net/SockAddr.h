@@ -0,0 +1,102 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <scraps/net/Address.h>
+#include <scraps/net/Endpoint.h>
+
+#include <cstring>
+#include <type_traits>
+
+namespace scraps::net {
+
+/**
+* A socket address that's trivially copyable and cheap to compare and hash, for paths that handle
+* an address per packet. Unlike Endpoint, converting to and from a native sockaddr is a memcpy.
+*
+* Unused bytes are always zero, so comparison and hashing work on whole words.
+*/
+class SockAddr {
+public:
+    SockAddr() = default;
+
+    /**
+    * Copies a native IPv4 or IPv6 address. Other families result in an empty address.
+    */
+    SockAddr(const sockaddr* address, socklen_t length) {
+        if (address->sa_family == AF_INET && length >= sizeof(sockaddr_in)) {
+            memcpy(&_storage.v4, address, sizeof(sockaddr_in));
+        } else if (address->sa_family == AF_INET6 && length >= sizeof(sockaddr_in6)) {
+            memcpy(&_storage.v6, address, sizeof(sockaddr_in6));
+        }
+    }
+
+    SockAddr(const Address& address, uint16_t port);
+    SockAddr(const Endpoint& endpoint) : SockAddr(endpoint.address(), endpoint.port()) {}
+
+    bool isV4() const { return _storage.generic.sa_family == AF_INET; }
+    bool isV6() const { return _storage.generic.sa_family == AF_INET6; }
+    bool empty() const { return !isV4() && !isV6(); }
+
+    Address address() const;
+    uint16_t port() const { return ntohs(isV4() ? _storage.v4.sin_port : _storage.v6.sin6_port); }
+    Endpoint endpoint() const { return Endpoint(address(), port()); }
+
+    const sockaddr* native() const { return &_storage.generic; }
+    socklen_t length() const { return isV4() ? sizeof(sockaddr_in) : isV6() ? sizeof(sockaddr_in6) : 0; }
+
+    size_t hash() const {
+        // the words are mixed independently, so this compiles to a handful of multiplies
+        auto& w = _storage.words;
+        auto h = (w[0] * 0x9e3779b97f4a7c15ull) ^ (w[1] * 0xc2b2ae3d27d4eb4full) ^ (w[2] * 0x165667b19e3779f9ull) ^ (w[3] * 0x27d4eb2f165667c5ull);
+        h ^= h >> 32;
+        return static_cast<size_t>(h);
+    }
+
+    bool operator==(const SockAddr& other) const {
+        auto& a = _storage.words;
+        auto& b = other._storage.words;
+        return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3])) == 0;
+    }
+
+    bool operator!=(const SockAddr& other) const { return !(*this == other); }
+
+private:
+    union {
+        uint64_t words[4] = {};
+        sockaddr generic;
+        sockaddr_in v4;
+        sockaddr_in6 v6;
+    } _storage;
+};
+
+static_assert(std::is_trivially_copyable<SockAddr>::value, "SockAddr should be trivially copyable");
+static_assert(sizeof(SockAddr) == 32, "SockAddr should be exactly four words");
+
+} // namespace scraps::net
+
+namespace std {
+
+template <>
+struct hash<scraps::net::SockAddr> {
+    size_t operator()(const scraps::net::SockAddr& address) const {
+        return address.hash();
+    }
+};
+
+} // namespace std
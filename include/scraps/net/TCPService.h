@@ -18,15 +18,27 @@
 #include <scraps/config.h>
 
 #include <scraps/RunLoop.h>
+#include <scraps/RunLoopGroup.h>
+#include <scraps/TimerWheel.h>
+#include <scraps/net/Endpoint.h>
+#include <scraps/net/Resolver.h>
 #include <scraps/thread.h>
-#include <unordered_map>
+
+#include <stdts/optional.h>
 
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
-#include <queue>
+#include <mutex>
+#include <limits>
 #include <random>
+#include <string>
+#include <vector>
 #include <cassert>
 
 namespace scraps::net {
@@ -35,22 +47,42 @@ struct TCPServiceDelegate;
 
 /**
 * Thread-safe.
+*
+* By default, the service runs on a single thread. Given a RunLoopGroup with multiple loops, each
+* connection is assigned to one of the group's loops, and delegate methods may be invoked
+* concurrently from multiple threads (though never concurrently for the same connection).
 */
 class TCPService {
 public:
-    TCPService(TCPServiceDelegate* delegate) : _delegate(delegate), _connectionIdCounter(0) {}
+    /**
+    * @param group if given, the service runs on the group's loops instead of its own thread. the
+    *              service takes control of the group, which must outlive it
+    */
+    explicit TCPService(TCPServiceDelegate* delegate, RunLoopGroup* group = nullptr);
     ~TCPService();
 
+    static constexpr int kDefaultListenBacklog = SOMAXCONN;
+
+    // the most connections accepted from a listening socket each time it becomes readable
+    static constexpr size_t kAcceptBatchSize = 64;
+
     /**
-    * Binds the service to interface and port. If the port is not given, an
-    * open port will be chosen by the operating system. This can be retrieved
-    * with the port() method.
+    * Binds the service to interface and port. The interface may be an IPv4 or IPv6 address, and
+    * binding to "::" accepts both IPv4 and IPv6 connections where supported. If the port is not
+    * given, an open port will be chosen by the operating system. This can be retrieved with the
+    * port() method.
+    *
+    * If the service runs on multiple loops and SO_REUSEPORT is supported, each loop gets its own
+    * listening socket and the kernel distributes incoming connections between them. Otherwise
+    * connections are accepted by the first loop and handed off.
     *
     * start() should be called afterwards to start listening.
     *
+    * @param backlog the maximum length of each listening socket's queue of pending connections
+    *
     * Returns true if successful.
     */
-    bool bind(const std::string& interface, uint16_t port = 0);
+    bool bind(const std::string& interface, uint16_t port = 0, int backlog = kDefaultListenBacklog);
 
     /**
     * Returns the currently bound listening port.
@@ -73,38 +105,62 @@ public:
     void wait() const;
 
     /**
-    * Sets a function to be invoked by the service thread after a specified delay.
+    * Sets a function to be invoked by the service thread after a specified delay. The returned
+    * handle can be used to cancel or reschedule it, e.g. for per-connection timeouts.
+    *
+    * If the service runs on multiple loops, the function is invoked by the first one.
     */
-    void async(const std::function<void()>& function, std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    RunLoop::TimerHandle async(const std::function<void()>& function, std::chrono::steady_clock::duration delay = std::chrono::steady_clock::duration::zero());
 
     /**
     * Indicates whether or not the current thread belongs to the service.
     */
     bool isCurrentThread() const;
 
-    typedef uint32_t ConnectionId;
+    typedef uint64_t ConnectionId;
+
+    /**
+    * Sets a function to be invoked after a specified delay by the thread that handles the given
+    * connection.
+    */
+    RunLoop::TimerHandle async(ConnectionId connectionId, const std::function<void()>& function, std::chrono::steady_clock::duration delay = std::chrono::steady_clock::duration::zero());
 
     /**
     * Initiates a connection to the address.
     *
-    * @return the id of the new connection
+    * @return the id of the new connection, or 0 if the service has too many connections
     */
     ConnectionId connect(sockaddr* address, size_t addressLength);
 
     /**
-    * Initiates a connection to the address.
+    * Initiates a connection to the host, which may be an IPv4 or IPv6 address or a hostname.
+    * Hostnames are resolved asynchronously by the service's resolver. If resolution fails, the
+    * delegate's tcpServiceConnectionFailed is invoked.
     *
-    * @return the id of the new connection
+    * If a hostname has several addresses, they're tried one at a time, alternating between IPv4
+    * and IPv6, until one of them connects. Each attempt gets its own connect timeout.
+    *
+    * @return the id of the new connection, or 0 if the service has too many connections
     */
     ConnectionId connect(const std::string& host, uint16_t port);
 
+    /**
+    * Sets the resolver used to connect to hostnames. Resolvers can be shared by several services
+    * to share their caches. If none is set, the service creates its own when it's first needed.
+    */
+    void setResolver(std::shared_ptr<Resolver> resolver);
+
+    std::shared_ptr<Resolver> resolver();
+
     /**
     * Sends data through the given connection.
     *
     * If the connection isn't yet established or the data can't be sent immediately, it's buffered and sent as soon as
     * possible.
+    *
+    * @return false if the data was rejected because it would exceed the service's queue limit
     */
-    void send(ConnectionId connectionId, const void* data, size_t length);
+    bool send(ConnectionId connectionId, const void* data, size_t length);
 
     /**
     * Sends data through the given connection.
@@ -112,7 +168,155 @@ public:
     * If the connection isn't yet established or the data can't be sent immediately, it's buffered and sent as soon as
     * possible.
     */
-    void send(ConnectionId connectionId, const std::string& data) { send(connectionId, data.data(), data.size()); }
+    bool send(ConnectionId connectionId, const std::string& data) { return send(connectionId, data.data(), data.size()); }
+
+    /**
+    * Sends data through the given connection without copying it.
+    *
+    * The owner is released once the data has been sent or the connection is closed, so the data
+    * must remain valid and unmodified until then. A custom deleter can be used to find out when
+    * that happens.
+    */
+    bool send(ConnectionId connectionId, const void* data, size_t length, std::shared_ptr<const void> owner);
+
+    /**
+    * Sends an immutable buffer through the given connection without copying it. The same buffer
+    * can be sent through any number of connections.
+    */
+    bool send(ConnectionId connectionId, std::shared_ptr<const std::string> data) {
+        auto bytes = data->data();
+        auto length = data->size();
+        return send(connectionId, bytes, length, std::move(data));
+    }
+
+    /**
+    * Sends an immutable buffer through each of the given connections without copying it. This
+    * schedules work once per loop rather than once per connection, so it's the cheapest way to
+    * broadcast.
+    *
+    * @return false if the data was rejected for every connection because it would exceed the
+    *         service's queue limit
+    */
+    bool send(const std::vector<ConnectionId>& connectionIds, std::shared_ptr<const std::string> data);
+
+    static constexpr size_t kDefaultSendQueueLowWaterMark = 256 * 1024;
+    static constexpr size_t kDefaultSendQueueHighWaterMark = 1024 * 1024;
+
+    /**
+    * Once a connection has at least high bytes waiting to be sent, the delegate's
+    * tcpServiceConnectionBackpressure is invoked. Once it drains to low bytes or fewer,
+    * tcpServiceConnectionWritable is invoked. Data isn't rejected either way, so it's up to
+    * producers to respond.
+    */
+    void setSendQueueWaterMarks(size_t low, size_t high) {
+        assert(low <= high);
+        _sendQueueLowWaterMark = low;
+        _sendQueueHighWaterMark = high;
+    }
+
+    /**
+    * Limits the number of bytes waiting to be sent across all connections. Sends that would
+    * exceed the limit are rejected. By default, there is no limit.
+    */
+    void setMaxQueuedBytes(size_t bytes) { _maxQueuedBytes = bytes; }
+
+    struct Stats {
+        // each flush of a connection's send queue is a single sendmsg call
+        uint64_t sendCalls = 0;
+        // the number of buffers (iovecs) passed to those calls. divided by sendCalls, this
+        // gives the average number of buffers coalesced per flush
+        uint64_t sendBuffers = 0;
+        uint64_t bytesSent = 0;
+
+        // the number of bytes currently waiting to be sent, and the number of sends rejected
+        // because of setMaxQueuedBytes
+        uint64_t bytesQueued = 0;
+        uint64_t sendsRejected = 0;
+
+        // the number of times connections were readable, and the number of recv calls and bytes
+        // that resulted
+        uint64_t receiveWakeups = 0;
+        uint64_t receiveCalls = 0;
+        uint64_t bytesReceived = 0;
+        // the number of times a connection was still readable after using its receive budget
+        uint64_t receiveBudgetExhausted = 0;
+
+        // the number of times listening sockets were readable, and the number of connections
+        // accepted as a result. sample these periodically to get accept rates
+        uint64_t acceptWakeups = 0;
+        uint64_t connectionsAccepted = 0;
+        uint64_t acceptErrors = 0;
+        // the number of times a full batch was accepted, possibly leaving connections pending
+        // until the next iteration
+        uint64_t acceptBatchExhausted = 0;
+        // the number of incoming connections refused because of setMaxConnections or the
+        // delegate's tcpServiceShouldAcceptConnection
+        uint64_t connectionsRejected = 0;
+
+        // the number of connections closed because of a connect or idle timeout
+        uint64_t connectionsTimedOut = 0;
+    };
+
+    /**
+    * Returns the service's counters, totaled across all of its loops.
+    */
+    Stats stats() const;
+
+    static constexpr size_t kDefaultReceiveBudget = 256 * 1024;
+
+    /**
+    * Sets the maximum number of bytes read from a connection each time it becomes readable. Once a
+    * connection's budget is used, the loop moves on to other connections and events before reading
+    * more, so that a single fast peer can't starve the rest. Each wakeup reads at least once, so a
+    * budget of zero is treated as one byte.
+    */
+    void setReceiveBudget(size_t bytes) { _receiveBudget = std::max<size_t>(bytes, 1); }
+
+    /**
+    * Sets how long an outgoing connection may take to be established before it fails. Zero, the
+    * default, disables the timeout.
+    */
+    void setConnectTimeout(std::chrono::steady_clock::duration timeout) { _connectTimeout = timeout; }
+
+    /**
+    * Sets how long a connection may go without receiving data before it's closed. Zero, the
+    * default, disables the timeout.
+    */
+    void setIdleReadTimeout(std::chrono::steady_clock::duration timeout) { _idleReadTimeout = timeout; }
+
+    /**
+    * Sets how long a connection may have data waiting to be sent without making progress before
+    * it's closed. Connections with nothing to send never time out this way. Zero, the default,
+    * disables the timeout.
+    */
+    void setIdleWriteTimeout(std::chrono::steady_clock::duration timeout) { _idleWriteTimeout = timeout; }
+
+    /**
+    * Sets whether TCP_NODELAY is set on new connections, disabling Nagle's algorithm. Enabled by
+    * default.
+    */
+    void setNoDelay(bool enabled) { _noDelay = enabled; }
+
+    /**
+    * Enables TCP keepalive probes on new connections. Zero values use the system defaults.
+    *
+    * @param idle how long a connection must be idle before probes are sent
+    * @param interval the time between probes
+    * @param probes the number of unanswered probes after which the connection is dropped
+    */
+    void setKeepAlive(bool enabled, std::chrono::seconds idle = std::chrono::seconds::zero(), std::chrono::seconds interval = std::chrono::seconds::zero(), int probes = 0) {
+        _keepAliveIdle = idle;
+        _keepAliveInterval = interval;
+        _keepAliveProbes = probes;
+        _keepAlive = enabled;
+    }
+
+    /**
+    * Limits the number of open connections. Once the limit is reached, incoming connections are
+    * accepted and immediately closed. Outgoing connections count towards the limit, but are never
+    * refused. By default, there is no limit.
+    */
+    void setMaxConnections(size_t connections) { _maxConnections = connections; }
 
     /**
     * Gracefully closes the given connection.
@@ -124,27 +328,43 @@ public:
 private:
     TCPServiceDelegate* const _delegate = nullptr;
 
-    mutable std::thread _thread;
-
-    RunLoop _runLoop;
+    std::unique_ptr<RunLoopGroup> _ownedGroup;
+    RunLoopGroup* const _group;
 
-    std::atomic<ConnectionId> _connectionIdCounter;
-
-    int _listenFD = -1;
+    static constexpr std::chrono::steady_clock::duration kTimeoutResolution = std::chrono::milliseconds(10);
 
     struct Connection {
         const ConnectionId id;
-        const int fd;
+        // only replaced when connecting moves on to another address
+        int fd;
         enum State { kConnecting, kConnected, kClosing };
 
         State state;
 
         struct SendBuffer {
-            std::string data;
+            std::shared_ptr<const void> owner;
+            const char* data = nullptr;
+            size_t length = 0;
             size_t sent = 0;
         };
 
-        std::queue<std::shared_ptr<SendBuffer>> sendQueue;
+        // buffers before sendQueueHead have been sent. unlike a deque, an empty vector doesn't
+        // allocate, which matters for idle connections
+        std::vector<SendBuffer> sendQueue;
+        size_t sendQueueHead = 0;
+        // the number of unsent bytes in sendQueue
+        size_t queuedBytes = 0;
+        bool isBackpressured = false;
+
+        // the addresses to try next if connecting fails
+        std::vector<Endpoint> connectCandidates;
+
+        // only maintained for connections with a timeout
+        TimerWheel<ConnectionId>::Id timeoutId = TimerWheel<ConnectionId>::kInvalidId;
+        std::chrono::steady_clock::time_point timeoutDeadline;
+        std::chrono::steady_clock::time_point lastReceive;
+        // the last time sending made progress, or the time the send queue became non-empty
+        std::chrono::steady_clock::time_point lastSend;
 
         Connection(ConnectionId connectionId, int fd, State state) : id(connectionId), fd(fd), state(state) {
             assert(fd >= 0);
@@ -158,62 +378,209 @@ private:
         bool close();
     };
 
-    struct ConnectionMap {
-        bool empty() const { return _idMap.empty(); }
-
-        std::shared_ptr<Connection> front() const { return _idMap.begin()->second; }
-
-        template <typename... Args>
-        std::shared_ptr<Connection> emplace(Args... args) {
-            auto connection = std::make_shared<Connection>(std::forward<Args>(args)...);
-            _idMap.emplace(connection->id, connection);
-            _fdMap.emplace(connection->fd, connection);
-            assert(_fdMap.size() == _idMap.size());
-            return connection;
-        }
-
-        void erase(ConnectionId connectionId) {
-            auto it = _idMap.find(connectionId);
-            if (it == _idMap.end()) {
-                return;
+    /**
+    * A generational slot map of connections. Ids encode a slot and the slot's generation, and file
+    * descriptors index a vector directly, so lookups don't hash or touch reference counts. Erasing
+    * a connection bumps its slot's generation, which invalidates any ids that still refer to it.
+    *
+    * Ids can be reserved by any thread. Everything else is only done by the shard's thread.
+    */
+    class ConnectionTable {
+    public:
+        ConnectionTable(size_t shardIndex, size_t shardCount);
+        ~ConnectionTable();
+
+        /**
+        * Reserves a slot for a connection. Thread-safe.
+        *
+        * @return the connection's id, or 0 if every slot is in use
+        */
+        ConnectionId reserve();
+
+        /**
+        * Frees a reserved slot that never got a connection.
+        */
+        void release(ConnectionId connectionId);
+
+        /**
+        * Constructs a connection in a reserved slot.
+        */
+        Connection& emplace(ConnectionId connectionId, int fd, Connection::State state);
+
+        void erase(Connection& connection);
+
+        /**
+        * Moves a connection to a new file descriptor. The old one isn't closed.
+        */
+        void setFd(Connection& connection, int fd);
+
+        Connection* findById(ConnectionId connectionId) const;
+        Connection* findByFd(int fd) const { return fd >= 0 && static_cast<size_t>(fd) < _fdSlots.size() && _fdSlots[fd] ? &*_slot(_fdSlots[fd] - 1).connection : nullptr; }
+
+        bool empty() const { return !_size; }
+
+        /**
+        * Invokes f for each connection. f may erase the connection it's given.
+        */
+        template <typename F>
+        void forEach(F&& f) {
+            uint32_t count;
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                count = _slotCount;
             }
-            auto& connection = *it->second;
-            connection.close();
-            _fdMap.erase(connection.fd);
-            _idMap.erase(it);
-            assert(_fdMap.size() == _idMap.size());
-        }
 
-        std::shared_ptr<Connection> findById(ConnectionId connectionId) const {
-            auto it = _idMap.find(connectionId);
-            if (it == _idMap.end()) {
-                return nullptr;
+            // slots never move, so erasing connections along the way doesn't disturb the walk
+            for (uint32_t i = 0; i < count && _size; ++i) {
+                auto& slot = _slot(i);
+                if (slot.connection) {
+                    f(*slot.connection);
+                }
             }
-            return it->second;
         }
 
-        std::shared_ptr<Connection> findByFd(int fd) const {
-            auto it = _fdMap.find(fd);
-            if (it == _fdMap.end()) {
-                return nullptr;
-            }
-            return it->second;
-        }
+        static size_t ShardIndex(ConnectionId connectionId, size_t shardCount) { return ((connectionId & 0xffffffff) - 1) % shardCount; }
 
     private:
-        std::unordered_map<ConnectionId, std::shared_ptr<Connection>> _idMap;
-        std::unordered_map<int, std::shared_ptr<Connection>> _fdMap;
-    };
+        struct Slot {
+            uint32_t generation = 0;
+            stdts::optional<Connection> connection;
+        };
 
-    ConnectionMap _connections;
+        // slots are allocated in chunks so that they never move and reserve never needs to
+        // synchronize with lookups
+        static constexpr size_t kChunkSize = 256;
+        static constexpr size_t kMaxChunks = 4096;
 
-    std::default_random_engine _prng{static_cast<std::default_random_engine::result_type>(std::chrono::system_clock::now().time_since_epoch().count())};
+        const size_t _shardIndex;
+        const size_t _shardCount;
+        std::unique_ptr<std::atomic<Slot*>[]> _chunks;
+        size_t _size = 0;
+        // the slot index + 1 of the connection using each file descriptor, or 0
+        std::vector<uint32_t> _fdSlots;
 
-    void _eventHandler(int fd, short events);
+        std::mutex _mutex;
+        uint32_t _slotCount = 0;
+        std::vector<uint32_t> _freeSlots;
+
+        Slot& _slot(uint32_t index) const { return _chunks[index / kChunkSize].load(std::memory_order_acquire)[index % kChunkSize]; }
+        Slot* _find(ConnectionId connectionId) const;
+    };
 
-    void _connect(ConnectionId connectionId, const sockaddr* address, size_t addressLength);
-    void _trySend(Connection& connection);
-    void _closeAndErase(Connection& connection);
+    /**
+    * The state owned by one of the group's loops. Only accessed by that loop's thread, except for
+    * reserving connection ids.
+    */
+    struct Shard {
+        Shard(size_t index, size_t count, RunLoop& runLoop) : index{index}, runLoop(runLoop), connections{index, count} {}
+
+        const size_t index;
+        RunLoop& runLoop;
+        int listenFD = -1;
+        // set by the loop once it has stopped, so that late handoffs aren't registered
+        bool isStopping = false;
+        ConnectionTable connections;
+        std::vector<iovec> iovecs;
+
+        // connection timeouts are kept in a wheel that's driven by a single run loop timer, which
+        // is scheduled for the wheel's next expiration
+        TimerWheel<ConnectionId> timeouts{kTimeoutResolution};
+        std::vector<ConnectionId> expiredTimeouts;
+        RunLoop::TimerHandle timeoutTimer;
+        stdts::optional<std::chrono::steady_clock::time_point> timeoutTimerDeadline;
+
+        struct ReceiveBuffer {
+            std::shared_ptr<const void> owner;
+            char* data = nullptr;
+        };
+
+        // buffers are reused once delegates are done with them
+        std::vector<ReceiveBuffer> receiveBuffers;
+        size_t receiveBufferIndex = 0;
+
+        // written by the loop's thread, but read by stats()
+        std::atomic<uint64_t> sendCalls{0};
+        std::atomic<uint64_t> sendBuffers{0};
+        std::atomic<uint64_t> bytesSent{0};
+        std::atomic<uint64_t> receiveWakeups{0};
+        std::atomic<uint64_t> receiveCalls{0};
+        std::atomic<uint64_t> bytesReceived{0};
+        std::atomic<uint64_t> receiveBudgetExhausted{0};
+        std::atomic<uint64_t> acceptWakeups{0};
+        std::atomic<uint64_t> connectionsAccepted{0};
+        std::atomic<uint64_t> acceptErrors{0};
+        std::atomic<uint64_t> acceptBatchExhausted{0};
+        std::atomic<uint64_t> connectionsRejected{0};
+        std::atomic<uint64_t> connectionsTimedOut{0};
+
+        std::default_random_engine prng{static_cast<std::default_random_engine::result_type>(std::chrono::system_clock::now().time_since_epoch().count() + index)};
+    };
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<size_t> _nextShard{0};
+    std::atomic<size_t> _receiveBudget{kDefaultReceiveBudget};
+
+    std::atomic<std::chrono::steady_clock::duration> _connectTimeout{std::chrono::steady_clock::duration::zero()};
+    std::atomic<std::chrono::steady_clock::duration> _idleReadTimeout{std::chrono::steady_clock::duration::zero()};
+    std::atomic<std::chrono::steady_clock::duration> _idleWriteTimeout{std::chrono::steady_clock::duration::zero()};
+
+    std::atomic<bool> _noDelay{true};
+    std::atomic<bool> _keepAlive{false};
+    std::atomic<std::chrono::seconds> _keepAliveIdle{std::chrono::seconds::zero()};
+    std::atomic<std::chrono::seconds> _keepAliveInterval{std::chrono::seconds::zero()};
+    std::atomic<int> _keepAliveProbes{0};
+
+    std::atomic<size_t> _maxConnections{std::numeric_limits<size_t>::max()};
+    std::atomic<size_t> _openConnections{0};
+
+    std::mutex _resolverMutex;
+    std::shared_ptr<Resolver> _resolver;
+    Resolver::TaskScope _resolveScope;
+
+    std::atomic<size_t> _sendQueueLowWaterMark{kDefaultSendQueueLowWaterMark};
+    std::atomic<size_t> _sendQueueHighWaterMark{kDefaultSendQueueHighWaterMark};
+    std::atomic<size_t> _maxQueuedBytes{std::numeric_limits<size_t>::max()};
+    std::atomic<size_t> _queuedBytes{0};
+    std::atomic<uint64_t> _sendsRejected{0};
+
+    bool _reserveQueuedBytes(size_t bytes);
+    void _releaseQueuedBytes(size_t bytes) { _queuedBytes -= bytes; }
+    size_t _listeners = 0;
+
+    // connection ids encode their shard so that any thread can route work to the right loop
+    Shard& _shard(ConnectionId connectionId) { return *_shards[ConnectionTable::ShardIndex(connectionId, _shards.size())]; }
+    Shard& _nextConnectionShard() { return *_shards[_nextShard++ % _shards.size()]; }
+
+    void _eventHandler(Shard& shard, int fd, short events);
+
+    // owns a connection that's being handed off to another shard until it's added
+    struct AcceptedConnection;
+    // owns an outgoing connection's reserved id until the shard starts connecting
+    struct PendingConnection;
+
+    void _accept(Shard& shard);
+    void _addAcceptedConnection(Shard& shard, ConnectionId connectionId, int fd);
+    void _discardAcceptedConnection(Shard& shard, ConnectionId connectionId, int fd);
+    void _discardPendingConnection(Shard& shard, ConnectionId connectionId);
+    void _connect(Shard& shard, ConnectionId connectionId, const sockaddr* address, size_t addressLength);
+    void _connect(Shard& shard, ConnectionId connectionId, std::vector<Endpoint> candidates);
+    int _openConnectingSocket(const sockaddr* address, size_t addressLength);
+    int _openConnectingSocket(std::vector<Endpoint>& candidates);
+    Connection& _addConnectingSocket(Shard& shard, ConnectionId connectionId, int fd);
+    bool _connectNextCandidate(Shard& shard, Connection& connection);
+    Shard::ReceiveBuffer& _receiveBuffer(Shard& shard);
+    bool _receive(Shard& shard, Connection& connection);
+    void _send(Shard& shard, ConnectionId connectionId, const Connection::SendBuffer& buffer);
+    bool _trySend(Shard& shard, Connection& connection);
+    void _closeAndErase(Shard& shard, Connection& connection);
+    void _closeAll(Shard& shard);
+
+    void _configureSocket(int fd);
+
+    stdts::optional<std::chrono::steady_clock::time_point> _timeoutDeadline(const Connection& connection);
+    void _updateTimeout(Shard& shard, Connection& connection);
+    void _armTimeouts(Shard& shard);
+    void _expireTimeouts(Shard& shard);
 };
 
 struct TCPServiceDelegate {
@@ -222,7 +589,44 @@ struct TCPServiceDelegate {
     virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId,
                                                   const void* data,
                                                   size_t length) {}
+
+    /**
+    * Invoked when data is received. By default, this invokes tcpServiceConnectionReceivedData.
+    *
+    * The data belongs to a pooled buffer, which can be retained by copying buffer instead of
+    * copying the data. The buffer is reused once it's released.
+    */
+    virtual void tcpServiceConnectionReceivedBuffer(TCPService::ConnectionId connectionId,
+                                                    const std::shared_ptr<const void>& buffer,
+                                                    const void* data,
+                                                    size_t length) {
+        tcpServiceConnectionReceivedData(connectionId, data, length);
+    }
     virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) {}
+
+    /**
+    * Invoked when a connection times out, just before tcpServiceConnectionFailed or
+    * tcpServiceConnectionClosed.
+    */
+    virtual void tcpServiceConnectionTimedOut(TCPService::ConnectionId connectionId) {}
+
+    /**
+    * Invoked for each incoming connection. Returning false closes it immediately, e.g. to limit
+    * connections per address.
+    */
+    virtual bool tcpServiceShouldAcceptConnection(const sockaddr* address, size_t addressLength) { return true; }
+
+    /**
+    * Invoked when a connection's unsent data reaches the high water mark. Producers should pause
+    * until tcpServiceConnectionWritable is invoked.
+    */
+    virtual void tcpServiceConnectionBackpressure(TCPService::ConnectionId connectionId) {}
+
+    /**
+    * Invoked when a connection's unsent data drains to the low water mark after reaching the
+    * high water mark.
+    */
+    virtual void tcpServiceConnectionWritable(TCPService::ConnectionId connectionId) {}
 };
 
 } // namespace scraps::net
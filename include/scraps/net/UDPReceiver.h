@@ -18,6 +18,10 @@
 #include <scraps/config.h>
 
 #include <scraps/net/Endpoint.h>
+#include <scraps/net/SockAddr.h>
+
+#include <chrono>
+#include <memory>
 
 namespace scraps::net {
 
@@ -26,6 +30,35 @@ public:
     virtual ~UDPReceiver() {}
 
     virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) = 0;
+
+    struct Datagram {
+        SockAddr sender;
+        // the pooled buffer that holds the data. it can be retained to keep the data valid
+        // without copying it, e.g. to process it on another thread, and is reused once released
+        std::shared_ptr<const void> buffer;
+        const void* data = nullptr;
+        size_t length = 0;
+
+        // when the datagram arrived. with UDPSocket::setReceiveMetadata, this is the kernel's
+        // timestamp, which excludes any time spent queued before it was read
+        std::chrono::steady_clock::time_point timestamp;
+        // the local address the datagram was sent to. only set with UDPSocket::setReceiveMetadata
+        Address destination;
+        // the ECN codepoint, i.e. the low two bits of the TOS or traffic class. only set with
+        // UDPSocket::setReceiveMetadata
+        uint8_t ecn = 0;
+    };
+
+    /**
+    * Invoked with datagrams that were received together. Unless a datagram's buffer is retained,
+    * its data is only valid until this returns. By default, this invokes receiveUDP for each
+    * datagram.
+    */
+    virtual void receiveUDPBatch(const Datagram* datagrams, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            receiveUDP(datagrams[i].sender.endpoint(), datagrams[i].data, datagrams[i].length);
+        }
+    }
 };
 
 } // namespace scraps::net
@@ -18,6 +18,7 @@
 #include <scraps/config.h>
 
 #include <scraps/net/Endpoint.h>
+#include <scraps/net/SockAddr.h>
 
 namespace scraps::net {
 
@@ -26,6 +27,33 @@ public:
     virtual ~UDPSender() {}
 
     virtual bool send(const Endpoint& destination, const void* data, size_t length) = 0;
+
+    /**
+    * Sends to a destination that has already been converted. By default, this converts it back to
+    * an Endpoint and invokes send.
+    */
+    virtual bool send(const SockAddr& destination, const void* data, size_t length) {
+        return send(destination.endpoint(), data, length);
+    }
+
+    struct Datagram {
+        SockAddr destination;
+        const void* data = nullptr;
+        size_t length = 0;
+    };
+
+    /**
+    * Sends several datagrams. By default, this invokes send for each datagram.
+    *
+    * @return the number of datagrams sent
+    */
+    virtual size_t sendBatch(const Datagram* datagrams, size_t count) {
+        size_t sent = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sent += send(datagrams[i].destination, datagrams[i].data, datagrams[i].length);
+        }
+        return sent;
+    }
 };
 
 } // namespace scraps::net
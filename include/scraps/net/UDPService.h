@@ -18,18 +18,34 @@
 #include <scraps/config.h>
 
 #include <scraps/RunLoop.h>
+#include <scraps/RunLoopGroup.h>
 #include <scraps/net/UDPSocket.h>
 
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 namespace scraps::net {
 
 /**
 * Service for sending / receiving data via UDP. The service owns a thread that it will use to invoke socket methods.
 *
+* Given a RunLoopGroup with multiple loops, sockets are distributed between the loops' threads, and
+* each socket is only ever received on by one of them. Each socket goes to the loop with the fewest.
+*
+* Delivery doesn't lock: each loop looks sockets up in an immutable snapshot, which opening a socket
+* replaces rather than modifies. So opening sockets and receiving on them never wait on each other.
+*
 * Thread-safe.
 */
 class UDPService {
 public:
-    UDPService();
+    /**
+    * @param group if given, the service runs on the group's loops instead of its own thread. the
+    *              service takes control of the group, which must outlive it
+    */
+    explicit UDPService(RunLoopGroup* group = nullptr);
     ~UDPService();
 
     /**
@@ -39,6 +55,16 @@ public:
     */
     std::shared_ptr<UDPSocket> openSocket(UDPSocket::Protocol protocol, uint16_t port, std::weak_ptr<UDPReceiver> receiver = std::weak_ptr<UDPReceiver>(), const char* interface = nullptr);
 
+    /**
+    * Opens one socket per loop, all bound to the given port with SO_REUSEPORT, so that datagrams
+    * arriving on the port are received by every loop's thread. The kernel distributes datagrams
+    * by their source, so the receiver is invoked concurrently for different senders.
+    *
+    * Returns an empty vector if the sockets can't be opened. If port is 0, an ephemeral port is
+    * chosen for the first socket and shared by the rest.
+    */
+    std::vector<std::shared_ptr<UDPSocket>> openSocketGroup(UDPSocket::Protocol protocol, uint16_t port, std::weak_ptr<UDPReceiver> receiver = std::weak_ptr<UDPReceiver>(), const char* interface = nullptr);
+
     /**
     * Opens a socket in the given multicast groupd and returns a UDPSocket object.
     *
@@ -52,19 +78,39 @@ public:
     }
 
     /**
-    * Returns the service's run loop.
+    * Returns the service's run loop. If the service runs on multiple loops, this is the first one.
     */
-    RunLoop& runLoop() { return _runLoop; }
+    RunLoop& runLoop() { return _group->loop(0); }
 
     void kill();
 
 private:
-    std::mutex _mutex;
-    RunLoop _runLoop;
-    std::thread _thread;
-    std::unordered_map<int, std::weak_ptr<UDPSocket>> _sockets;
+    using SocketMap = std::unordered_map<int, std::weak_ptr<UDPSocket>>;
+
+    struct Shard {
+        // serializes changes to the sockets
+        std::mutex mutex;
+        // the current snapshot, which is replaced on change. only accessed via std::atomic_load
+        // and std::atomic_store
+        std::shared_ptr<const SocketMap> sockets = std::make_shared<SocketMap>();
+        std::atomic<uint64_t> version{0};
+
+        // only accessed by the shard's loop, which only reloads the snapshot when the version changes
+        std::shared_ptr<const SocketMap> loopSockets = sockets;
+        uint64_t loopVersion = 0;
+    };
+
+    std::unique_ptr<RunLoopGroup> _ownedGroup;
+    RunLoopGroup* const _group;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    bool _isRunning = false;
 
+    void _eventHandler(size_t index, int fd, short events);
+    void _addSocket(const std::shared_ptr<UDPSocket>& socket);
+    void _addSocket(const std::shared_ptr<UDPSocket>& socket, size_t index);
+    void _removeSocket(size_t index, int fd);
     void _purgeDeadSockets();
+    size_t _leastLoadedShard() const;
 };
 
 } // namespace scraps::net
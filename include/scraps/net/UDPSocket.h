@@ -25,6 +25,8 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <vector>
 
 namespace scraps::net {
 
@@ -42,6 +44,21 @@ public:
     static constexpr size_t kMaxIPv4UDPPayloadSize = kEthernetMTU - kIPv4HeaderSize - kUDPHeaderSize;
     static constexpr size_t kMaxIPv6UDPPayloadSize = kEthernetMTU - kIPv6HeaderSize - kUDPHeaderSize;
 
+    // the most datagrams received or sent with a single system call
+    static constexpr size_t kBatchSize = 32;
+    // larger datagrams are truncated when received
+    static constexpr size_t kReceiveBufferSize = 4096;
+
+    // limits on segmentation offload, which are imposed by the kernel
+    static constexpr size_t kMaxOffloadSegments = 64;
+    static constexpr size_t kMaxOffloadSize = 65535 - kIPv6HeaderSize - kUDPHeaderSize;
+    // the number of coalesced buffers received with a single system call
+    static constexpr size_t kOffloadBatchSize = 8;
+
+    // the most receive buffers kept for reuse. beyond this, buffers retained by receivers are
+    // replaced with new ones
+    static constexpr size_t kMaxPooledReceiveBuffers = 4 * kBatchSize;
+
     /**
     * Creates a new UDP socket.
     *
@@ -62,6 +79,18 @@ public:
     */
     void setReceiver(std::weak_ptr<UDPReceiver> receiver);
 
+    /**
+    * Allows other sockets to bind to the same port, where supported. The kernel distributes
+    * incoming datagrams between them, so that each can be received on by a different thread. Must
+    * be invoked before binding.
+    */
+    bool setReusePort();
+
+    /**
+    * Returns the port the socket is bound to, or 0 if it isn't bound.
+    */
+    uint16_t port() const;
+
     /**
     * Binds the socket to any interface on the given port.
     */
@@ -78,12 +107,64 @@ public:
     bool bindMulticast(const char* groupAddress, uint16_t port);
 
     /**
-    * Sends data on the socket.
+    * Sends data on the socket. Sending doesn't lock, so any number of threads can send at once,
+    * including while another thread receives.
     */
     virtual bool send(const Endpoint& destination, const void* data, size_t length) override;
 
     /**
-    * Attempts to receive data on the socket and dispatch it to its receiver.
+    * Sends data to an address that has already been converted, avoiding the conversion of an
+    * Endpoint for every datagram.
+    */
+    virtual bool send(const SockAddr& destination, const void* data, size_t length) override;
+    bool send(const sockaddr* destination, socklen_t destinationLength, const void* data, size_t length);
+
+    /**
+    * Sends several datagrams, using a single system call per kBatchSize datagrams where supported.
+    * Like send, this doesn't lock.
+    */
+    virtual size_t sendBatch(const Datagram* datagrams, size_t count) override;
+
+    /**
+    * Enables or disables UDP segmentation offload, which is supported by Linux 4.18 and later for
+    * sending (GSO) and Linux 5.0 and later for receiving (GRO).
+    *
+    * When sending is offloaded, sendBatch sends runs of datagrams that share a destination and
+    * length as a single buffer, which the kernel or NIC splits up. When receiving is offloaded,
+    * the kernel coalesces datagrams from the same sender, and receive splits them back up before
+    * they're delivered. Receivers can't tell the difference either way.
+    *
+    * If the kernel turns out not to support offloading, the socket falls back to regular batching.
+    *
+    * @return true if offloading was enabled in either direction
+    */
+    bool setSegmentationOffload(bool enabled);
+
+    bool isSendOffloadEnabled() const { return _isSendOffloadEnabled; }
+    bool isReceiveOffloadEnabled() const { return _isReceiveOffloadEnabled; }
+
+    /**
+    * Enables or disables per-datagram metadata, which is delivered via receiveUDPBatch: kernel
+    * receive timestamps (SO_TIMESTAMPNS), destination addresses (IP_PKTINFO / IPV6_RECVPKTINFO),
+    * and ECN codepoints (IP_RECVTOS / IPV6_RECVTCLASS).
+    *
+    * Without it, datagrams are timestamped as soon as they're read instead. Linux turns on
+    * timestamping asynchronously, so datagrams that arrive right after enabling it may also be
+    * timestamped when they're read.
+    *
+    * @return true if metadata is supported and was enabled
+    */
+    bool setReceiveMetadata(bool enabled);
+
+    bool isReceiveMetadataEnabled() const { return _isReceiveMetadataEnabled; }
+
+    /**
+    * Attempts to receive data on the socket and dispatch it to its receiver. Datagrams are read up
+    * to kBatchSize at a time, using a single system call where supported, and are delivered via
+    * the receiver's receiveUDPBatch.
+    *
+    * Datagrams are received into pooled buffers, so this may be invoked by several threads at
+    * once, in which case the receiver is invoked concurrently.
     */
     void receive();
 
@@ -99,16 +180,45 @@ public:
     uint64_t totalReceivedBytes() { return _totalReceivedBytes; }
 
 private:
-    std::mutex _mutex;
-    int _socket = -1;
+    mutable std::mutex _mutex;
+    std::atomic<int> _socket;
+    // senders use the socket without locking. close clears it, then waits for the senders that
+    // already loaded it before closing the descriptor, so that it can't be reused under them
+    std::atomic<size_t> _activeSenders{0};
     Protocol _protocol;
     std::weak_ptr<UDPReceiver> _receiver;
-    std::array<unsigned char, 4096> _buffer;
+
+    std::atomic<bool> _isSendOffloadEnabled{false};
+    std::atomic<bool> _isReceiveOffloadEnabled{false};
+    std::atomic<bool> _isReceiveMetadataEnabled{false};
+
+    // each message is received into a pooled buffer of _receiveBufferSize bytes, which is larger
+    // when the kernel coalesces datagrams. buffers are free once only the pool references them
+    std::vector<std::shared_ptr<unsigned char>> _receiveBuffers;
+    size_t _receiveBufferSize = 0;
+    size_t _receiveBufferIndex = 0;
+
+    struct Message {
+        std::shared_ptr<unsigned char> buffer;
+        sockaddr_storage sender;
+        socklen_t senderLength = 0;
+        size_t length = 0;
+        // if non-zero, the message holds several datagrams of this size
+        size_t segmentSize = 0;
+        std::chrono::steady_clock::time_point timestamp;
+        Address destination;
+        uint8_t ecn = 0;
+    };
 
     std::atomic_uint_fast64_t _totalSentBytes{0};
     std::atomic_uint_fast64_t _totalReceivedBytes{0};
 
     bool _bind(const char* interface, uint16_t port);
+    size_t _receiveBatch(Message* messages, size_t* batchSize);
+    std::shared_ptr<unsigned char> _receiveBuffer(size_t size);
+    int _beginSend();
+    void _endSend();
+    size_t _sendBatch(int socket, const Datagram* datagrams, size_t count, bool offload);
 };
 
 } // namespace scraps::net
@@ -0,0 +1,58 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+
+#include <scraps/poller/PollerInterface.h>
+
+#include <sys/epoll.h>
+
+namespace scraps::poller {
+
+/**
+* Poller backed by a level-triggered epoll instance. Registration is O(1) and each wait is
+* O(ready file descriptors). Timeouts have nanosecond precision on Linux 5.11 or later and
+* millisecond precision otherwise.
+*/
+class EpollPoller : public PollerInterface {
+public:
+    /**
+    * Returns nullptr if the epoll instance can't be created.
+    */
+    static std::unique_ptr<EpollPoller> Create();
+
+    ~EpollPoller();
+
+    virtual bool set(int fd, short events) override;
+    virtual void remove(int fd) override;
+    virtual bool wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) override;
+
+private:
+    explicit EpollPoller(int epollFD) : _epollFD{epollFD}, _buffer(kInitialBufferSize) {}
+
+    static constexpr size_t kInitialBufferSize = 64;
+
+    const int _epollFD;
+    std::vector<epoll_event> _buffer;
+    bool _hasPwait2 = true;
+};
+
+} // namespace scraps::poller
+
+#endif
@@ -0,0 +1,76 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#if SCRAPS_LINUX && __has_include(<linux/io_uring.h>)
+
+#define SCRAPS_IO_URING 1
+
+#include <scraps/poller/PollerInterface.h>
+
+#include <unordered_map>
+
+namespace scraps::poller {
+
+/**
+* Poller backed by io_uring poll requests. Registration is O(1) and each wait is O(ready file
+* descriptors). Re-arming and removals are batched into the same system call as the wait.
+*
+* Unlike epoll, an armed poll request holds a reference to the file, so file descriptors should
+* be removed before they're closed.
+*
+* Requires Linux 5.11 or later. liburing is not required.
+*/
+class IOUringPoller : public PollerInterface {
+public:
+    static constexpr unsigned kDefaultEntries = 1024;
+
+    /**
+    * Returns nullptr if io_uring isn't supported or permitted.
+    */
+    static std::unique_ptr<IOUringPoller> Create(unsigned entries = kDefaultEntries);
+
+    ~IOUringPoller();
+
+    virtual bool set(int fd, short events) override;
+    virtual void remove(int fd) override;
+    virtual bool wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) override;
+
+private:
+    struct Ring;
+
+    struct Registration {
+        short events = 0;
+        uint32_t generation = 0;
+        bool armed = false;
+    };
+
+    explicit IOUringPoller(std::unique_ptr<Ring> ring);
+
+    std::unique_ptr<Ring> _ring;
+    std::unordered_map<int, Registration> _registrations;
+    std::vector<int> _completed;
+    uint32_t _generation = 0;
+
+    void _arm(int fd, Registration* registration);
+    void _disarm(int fd, const Registration& registration);
+};
+
+} // namespace scraps::poller
+
+#endif
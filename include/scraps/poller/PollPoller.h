@@ -0,0 +1,41 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <scraps/poller/PollerInterface.h>
+
+#include <unordered_map>
+
+namespace scraps::poller {
+
+/**
+* Portable poller backed by poll(). Registration is O(1), but each wait is O(n) in the number
+* of watched file descriptors.
+*/
+class PollPoller : public PollerInterface {
+public:
+    virtual bool set(int fd, short events) override;
+    virtual void remove(int fd) override;
+    virtual bool wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) override;
+
+private:
+    std::vector<struct pollfd> _descriptors;
+    std::unordered_map<int, size_t> _indices;
+};
+
+} // namespace scraps::poller
@@ -0,0 +1,90 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#pragma once
+
+#include <scraps/config.h>
+
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <vector>
+
+#include <poll.h>
+
+namespace scraps::poller {
+
+/**
+* A readiness notification for a single file descriptor. Event flags always use the poll
+* constants (POLLIN, POLLOUT, POLLHUP, etc.) regardless of the backend.
+*/
+struct Event {
+    int fd;
+    short events;
+};
+
+/**
+* Subclass this to create readiness backends for RunLoop.
+*
+* Implementations are level-triggered: as long as a file descriptor is ready, every call to
+* wait() reports it. POLLERR, POLLHUP, and POLLNVAL are always reported, even if not requested.
+*
+* Not thread-safe. A poller should only be used by the thread running its loop.
+*/
+class PollerInterface {
+public:
+    virtual ~PollerInterface() {}
+
+    /**
+    * Adds the file descriptor or updates the events it's watched for.
+    *
+    * @return false if the file descriptor couldn't be watched
+    */
+    virtual bool set(int fd, short events) = 0;
+
+    /**
+    * Stops watching the file descriptor. Does nothing if the file descriptor isn't watched.
+    */
+    virtual void remove(int fd) = 0;
+
+    /**
+    * Blocks until at least one file descriptor is ready or the timeout elapses, then appends
+    * the ready file descriptors to events.
+    *
+    * Backends should honor the timeout with at least microsecond precision where the platform
+    * allows it, so that RunLoop can wake up for timers with sub-millisecond deadlines.
+    *
+    * @param timeout if negative, the wait is indefinite
+    * @return false if an error occurred. errno is set accordingly
+    */
+    virtual bool wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) = 0;
+};
+
+/**
+* Converts a wait timeout to milliseconds for APIs such as poll() and epoll_wait(), rounding up
+* so that the wait never ends early.
+*/
+inline int TimeoutMilliseconds(std::chrono::nanoseconds timeout) {
+    if (timeout.count() < 0) { return -1; }
+    auto ms = (timeout.count() + 999999) / 1000000;
+    return ms > INT_MAX ? INT_MAX : static_cast<int>(ms);
+}
+
+/**
+* Returns the most scalable poller available on the current platform.
+*/
+std::unique_ptr<PollerInterface> CreateDefaultPoller();
+
+} // namespace scraps::poller
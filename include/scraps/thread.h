@@ -25,6 +25,7 @@
 #if SCRAPS_MACOS || SCRAPS_IOS
 #include <pthread.h>
 #elif SCRAPS_LINUX || SCRAPS_ANDROID
+#include <sched.h>
 #include <sys/prctl.h>
 #endif
 
@@ -38,6 +39,22 @@ inline void SetThreadName(stdts::string_view name) {
 #endif
 }
 
+/**
+* Restricts the current thread to the given CPU.
+*
+* @return false if the affinity couldn't be set or isn't supported on this platform
+*/
+inline bool SetThreadAffinity(unsigned cpu) {
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
 template<typename Rep, typename Period>
 std::chrono::steady_clock::duration TimedSleep(const std::chrono::duration<Rep, Period>& d) {
     auto now = std::chrono::steady_clock::now();
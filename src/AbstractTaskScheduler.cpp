@@ -0,0 +1,163 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/AbstractTaskScheduler.h>
+
+#include <vector>
+
+namespace scraps {
+
+namespace {
+
+constexpr size_t kBatchSize = 64;
+constexpr size_t kMaxDepotBatches = 64;
+
+struct Block {
+    Block* next;
+};
+
+struct Depot {
+    static void Free(Block* list) {
+        while (list) {
+            auto next = list->next;
+            ::operator delete(list);
+            list = next;
+        }
+    }
+
+    std::mutex          mutex;
+    std::vector<Block*> batches;
+};
+
+Depot& SharedDepot() {
+    // leaked so that it outlives any thread-local caches
+    static auto depot = new Depot;
+    return *depot;
+}
+
+struct Cache {
+    ~Cache() {
+        destroyed = true;
+        while (count >= kBatchSize) {
+            Release(Detach());
+        }
+        Depot::Free(head);
+    }
+
+    Block* Detach() {
+        auto batch = head;
+        auto tail = batch;
+        for (size_t i = 1; i < kBatchSize; ++i) {
+            tail = tail->next;
+        }
+        head = tail->next;
+        count -= kBatchSize;
+        tail->next = nullptr;
+        return batch;
+    }
+
+    static void Release(Block* batch) {
+        auto& depot = SharedDepot();
+        {
+            std::lock_guard<std::mutex> lock{depot.mutex};
+            if (depot.batches.size() < kMaxDepotBatches) {
+                depot.batches.push_back(batch);
+                return;
+            }
+        }
+        Depot::Free(batch);
+    }
+
+    Block* head = nullptr;
+    size_t count = 0;
+
+    // blocks freed after the cache is destroyed go straight back to the heap
+    static thread_local bool destroyed;
+};
+
+thread_local bool Cache::destroyed = false;
+thread_local Cache gCache;
+
+} // anonymous namespace
+
+constexpr size_t AbstractTaskScheduler::PostedTaskStorage::kBlockSize;
+
+void* AbstractTaskScheduler::PostedTaskStorage::allocate() {
+    if (Cache::destroyed) {
+        return ::operator new(kBlockSize);
+    }
+
+    auto& cache = gCache;
+
+    if (!cache.head) {
+        auto& depot = SharedDepot();
+        std::lock_guard<std::mutex> lock{depot.mutex};
+        if (!depot.batches.empty()) {
+            cache.head = depot.batches.back();
+            cache.count = kBatchSize;
+            depot.batches.pop_back();
+        }
+    }
+
+    if (!cache.head) {
+        return ::operator new(kBlockSize);
+    }
+
+    auto block = cache.head;
+    cache.head = block->next;
+    --cache.count;
+    return block;
+}
+
+void AbstractTaskScheduler::PostedTaskStorage::deallocate(void* p) {
+    if (Cache::destroyed) {
+        ::operator delete(p);
+        return;
+    }
+
+    auto& cache = gCache;
+
+    auto block = static_cast<Block*>(p);
+    block->next = cache.head;
+    cache.head = block;
+
+    if (++cache.count < 2 * kBatchSize) { return; }
+
+    // hand a batch to the depot so that threads which mostly allocate (e.g. producers) can reuse it
+    Cache::Release(cache.Detach());
+}
+
+void AbstractTaskScheduler::_heapInsert(std::vector<std::unique_ptr<Task>>* heap, std::vector<std::unique_ptr<Task>>* tasks) {
+    const auto size = heap->size();
+    heap->insert(heap->end(), std::make_move_iterator(tasks->begin()), std::make_move_iterator(tasks->end()));
+    tasks->clear();
+
+    // pushing each one costs O(k log n), so when there are enough of them it's faster to rebuild
+    if (heap->size() - size > size / 4) {
+        std::make_heap(heap->begin(), heap->end(), TaskComparer{});
+    } else {
+        for (auto it = heap->begin() + size + 1; it <= heap->end(); ++it) {
+            std::push_heap(heap->begin(), it, TaskComparer{});
+        }
+    }
+}
+
+void AbstractTaskScheduler::_asyncBatch(std::vector<std::unique_ptr<Task>> tasks) {
+    for (auto& task : tasks) {
+        _async(std::move(task));
+    }
+}
+
+} // namespace scraps
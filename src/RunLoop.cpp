@@ -22,104 +22,125 @@
 
 #include <unistd.h>
 
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+#include <sys/eventfd.h>
+#endif
+
 #include <cassert>
 
 namespace scraps {
 
-void RunLoop::run() {
-    {
-        std::lock_guard<std::mutex> lk{_pipeMutex};
+/**
+* The shared state of a function scheduled via async. The loop and any handles race to move it
+* out of the pending state, and whoever wins owns the function.
+*/
+struct RunLoop::Timer {
+    enum State {
+        kPending,
+        kInvoked,
+        kCancelled,
+    };
 
-        _wakeUpPipe[kWakeUpPipeInput] = -1;
-        _wakeUpPipe[kWakeUpPipeOutput] = -1;
+    explicit Timer(std::function<void()> func) : func{std::move(func)} {}
 
-        if (pipe(_wakeUpPipe)) {
-            SCRAPS_LOGF_ERROR("error creating wake up pipe (errno = %d)", static_cast<int>(errno));
-            return;
-        }
+    std::function<void()> func;
+    std::atomic<int> state{kPending};
+
+    // only accessed by the loop
+    TimerWheel<std::shared_ptr<Timer>>::Id id = TimerWheel<std::shared_ptr<Timer>>::kInvalidId;
+};
+
+constexpr std::chrono::steady_clock::duration RunLoop::kDefaultTimerResolution;
+
+RunLoop::RunLoop() : RunLoop(poller::CreateDefaultPoller()) {}
+
+RunLoop::RunLoop(std::chrono::steady_clock::duration timerResolution) : RunLoop(poller::CreateDefaultPoller(), timerResolution) {}
+
+RunLoop::RunLoop(std::unique_ptr<poller::PollerInterface> poller, std::chrono::steady_clock::duration timerResolution)
+    : _poller{std::move(poller)}
+    , _timers{timerResolution}
+{
+    assert(_poller);
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    _doorbell[kDoorbellInput] = _doorbell[kDoorbellOutput] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (_doorbell[kDoorbellInput] < 0) {
+        SCRAPS_LOG_ERROR("error creating doorbell eventfd (errno = {})", static_cast<int>(errno));
+    }
+#else
+    if (pipe(_doorbell)) {
+        SCRAPS_LOG_ERROR("error creating doorbell pipe (errno = {})", static_cast<int>(errno));
+        _doorbell[kDoorbellInput] = _doorbell[kDoorbellOutput] = -1;
+    } else if (!SetBlocking(_doorbell[kDoorbellInput], false) || !SetBlocking(_doorbell[kDoorbellOutput], false)) {
+        SCRAPS_LOG_ERROR("error making doorbell pipe non-blocking (errno = {})", static_cast<int>(errno));
     }
+#endif
+}
 
-    auto _ = gsl::finally([&] {
-        std::lock_guard<std::mutex> lk{_pipeMutex};
-        for (auto& fd : _wakeUpPipe) {
-            close(fd);
-            fd = -1;
-        }
-    });
+RunLoop::~RunLoop() {
+    if (_doorbell[kDoorbellOutput] >= 0) {
+        close(_doorbell[kDoorbellOutput]);
+    }
+    if (_doorbell[kDoorbellInput] >= 0 && _doorbell[kDoorbellInput] != _doorbell[kDoorbellOutput]) {
+        close(_doorbell[kDoorbellInput]);
+    }
+}
 
-    if (!SetBlocking(_wakeUpPipe[kWakeUpPipeInput], false) || !SetBlocking(_wakeUpPipe[kWakeUpPipeOutput], false)) {
-        SCRAPS_LOGF_ERROR("error making pipe non-blocking (errno = %d)", static_cast<int>(errno));
+void RunLoop::run() {
+    if (_doorbell[kDoorbellOutput] < 0) {
+        SCRAPS_LOG_ERROR("unable to run without a doorbell");
         return;
     }
 
-    {
-        _pollDescriptors.emplace_back();
-        auto& pfd = _pollDescriptors.back();
-        pfd.fd = _wakeUpPipe[kWakeUpPipeOutput];
-        pfd.events = POLLIN;
+    if (!_poller->set(_doorbell[kDoorbellOutput], POLLIN)) {
+        SCRAPS_LOG_ERROR("error polling doorbell");
+        return;
     }
 
-    _processPendingAdditionsAndRemovals();
+    auto _ = gsl::finally([&] {
+        _poller->remove(_doorbell[kDoorbellOutput]);
+    });
+
+    _processSubmissions();
 
     while (!_isCancelled) {
-        int timeout = -1;
-        {
-            std::lock_guard<std::mutex> lock{_mutex};
-            if (!_asyncFunctions.empty()) {
-                const auto now = std::chrono::steady_clock::now();
-                auto& next = _asyncFunctions.top();
-                std::chrono::milliseconds delay{0};
-                if (next.time > now) {
-                    delay = std::chrono::duration_cast<std::chrono::milliseconds>(next.time - now);
-                }
-                timeout = delay.count() < 0 ? 0 : delay.count();
-            }
+        std::chrono::nanoseconds timeout{-1};
+        if (auto next = _timers.nextExpiration()) {
+            const auto now = std::chrono::steady_clock::now();
+            timeout = *next > now ? std::chrono::duration_cast<std::chrono::nanoseconds>(*next - now) : std::chrono::nanoseconds::zero();
         }
 
-        auto result = poll(_pollDescriptors.data(), _pollDescriptors.size(), timeout);
+        // producers only ring the doorbell if they see that we're blocked. if they pushed before
+        // seeing that, we'll see their submission here instead
+        _isBlocked = true;
+        if (!_submissions.empty() || _isCancelled) {
+            timeout = std::chrono::nanoseconds::zero();
+        }
+
+        _events.clear();
+        auto success = _poller->wait(&_events, timeout);
+        _isBlocked = false;
 
-        if (result < 0) {
-            SCRAPS_LOGF_ERROR("error polling sockets (fds = %zu, errno = %d)", _pollDescriptors.size(), static_cast<int>(errno));
+        if (!success) {
+            SCRAPS_LOG_ERROR("error polling sockets (errno = {})", static_cast<int>(errno));
             break;
         }
 
-        _processPendingAdditionsAndRemovals();
-
-        auto remaining = result;
-        for (auto it = _pollDescriptors.begin(); remaining > 0 && it != _pollDescriptors.end(); ++it) {
-            if (!it->revents) { continue; }
-            --remaining;
+        _processSubmissions();
 
-            if (it->fd == _wakeUpPipe[kWakeUpPipeOutput]) {
-                char buf[10];
-                while (read(it->fd, buf, sizeof(buf)) > 0);
-                _shouldWake = false;
+        for (auto& event : _events) {
+            if (event.fd == _doorbell[kDoorbellOutput]) {
+                uint64_t buf[8];
+                while (read(event.fd, buf, sizeof(buf)) > 0);
                 continue;
             }
 
             if (_eventHandler) {
-                _eventHandler(it->fd, it->revents);
+                _eventHandler(event.fd, event.events);
             }
         }
 
-        std::vector<std::function<void()>> asyncFunctionsToCall;
-
-        {
-            std::lock_guard<std::mutex> lock{_mutex};
-            auto now = std::chrono::steady_clock::now();
-            while (!_asyncFunctions.empty()) {
-                auto& next = _asyncFunctions.top();
-                if (next.time > now) { break; }
-                asyncFunctionsToCall.emplace_back(std::move(next.func));
-                _asyncFunctions.pop();
-            }
-        }
-
-        for (auto& func : asyncFunctionsToCall) {
-            func();
-        }
-
-        _processPendingAdditionsAndRemovals();
+        _invokeExpiredTimers(std::chrono::steady_clock::now());
     }
 }
 
@@ -127,52 +148,63 @@ void RunLoop::setEventHandler(std::function<void(int fd, short events)> eventHan
     _eventHandler = std::move(eventHandler);
 }
 
-void RunLoop::async(std::function<void()> func, std::chrono::milliseconds delay) {
-    {
-        std::lock_guard<std::mutex> lock{_mutex};
-        _asyncFunctions.emplace(std::move(func), delay.count() ? std::chrono::steady_clock::now() + delay : std::chrono::steady_clock::time_point::min(), ++_asyncFunctionCounter);
+RunLoop::TimerHandle RunLoop::async(std::function<void()> func, std::chrono::steady_clock::duration delay) {
+    auto timer = std::make_shared<Timer>(std::move(func));
+
+    Submission submission;
+    submission.type = Submission::Type::kAsync;
+    submission.timer = timer;
+    submission.deadline = _deadline(delay);
+    _submit(std::move(submission));
+
+    return {this, std::move(timer)};
+}
+
+bool RunLoop::TimerHandle::cancel() {
+    if (!_timer) { return false; }
+
+    int expected = Timer::kPending;
+    if (!_timer->state.compare_exchange_strong(expected, Timer::kCancelled)) {
+        return false;
     }
-    _wakeUp();
+
+    // we own the function now, so it can be destroyed right away. the loop only needs to free its
+    // slot in the wheel, which isn't urgent enough to wake it for
+    _timer->func = nullptr;
+
+    Submission submission;
+    submission.type = Submission::Type::kCancel;
+    submission.timer = _timer;
+    _runLoop->_submissions.push(std::move(submission));
+    return true;
+}
+
+bool RunLoop::TimerHandle::reschedule(std::chrono::steady_clock::duration delay) {
+    if (!_timer || _timer->state != Timer::kPending) { return false; }
+
+    Submission submission;
+    submission.type = Submission::Type::kReschedule;
+    submission.timer = _timer;
+    submission.deadline = _runLoop->_deadline(delay);
+    // the new deadline may be earlier than the one the loop is currently waiting for
+    _runLoop->_submit(std::move(submission));
+    return true;
 }
 
 void RunLoop::flush() {
 
-    // Save now for the first loop, it shouldn't be changed after that.
-    // Any subsequent calls to async will be processed after the second
-    // loop only if they have no delay.
+    // Save now for the first pass, it shouldn't be changed after that.
+    // Any subsequent calls to async will be processed by later passes
+    // only if they have no delay.
     //
-    // next.time == std::chrono::steady_clock::time_point::min(), which is < now.
+    // Functions without a delay are due immediately, regardless of now.
     //
     // Otherwise any async func added with a delay will have a time > now and will
     // not be processed.
-    std::chrono::steady_clock::time_point now;
-    for (bool first = true;;) {
-        std::vector<std::function<void()>> asyncFunctionsToCall;
-
-        {
-            std::lock_guard<std::mutex> lock{_mutex};
-            if (first) {
-                now = std::chrono::steady_clock::now();
-            }
-
-            for (; !_asyncFunctions.empty(); _asyncFunctions.pop()) {
-                auto& next = _asyncFunctions.top();
-                if (next.time > now) { break; }
-
-                asyncFunctionsToCall.emplace_back(std::move(next.func));
-            }
-        }
-
-        if (asyncFunctionsToCall.empty()) { return; }
-
-        for (auto& func : asyncFunctionsToCall) {
-            func();
-        }
-
-        if (first) {
-            first = false;
-        }
-    }
+    const auto now = std::chrono::steady_clock::now();
+    do {
+        _processSubmissions();
+    } while (_invokeExpiredTimers(now));
 }
 
 void RunLoop::cancel() {
@@ -181,91 +213,111 @@ void RunLoop::cancel() {
 }
 
 void RunLoop::add(int fd, short events) {
-    {
-        std::lock_guard<std::mutex> lock{_mutex};
-        _pendingAdditions[fd] = events;
-        _pendingRemovals.erase(fd);
-    }
-    _wakeUp();
+    Submission submission;
+    submission.type = Submission::Type::kAdd;
+    submission.fd = fd;
+    submission.events = events;
+    _submit(std::move(submission));
 }
 
 void RunLoop::remove(int fd) {
-    {
-        std::lock_guard<std::mutex> lock{_mutex};
-        _pendingAdditions.erase(fd);
-        _pendingRemovals.insert(fd);
-    }
-    _wakeUp();
+    Submission submission;
+    submission.type = Submission::Type::kRemove;
+    submission.fd = fd;
+    _submit(std::move(submission));
 }
 
 void RunLoop::reset() {
-    std::lock(_mutex, _pipeMutex);
-    std::lock_guard<std::mutex> lk1(_mutex, std::adopt_lock);
-    std::lock_guard<std::mutex> lk2(_pipeMutex, std::adopt_lock);
-
     assert(_isCancelled);
     _isCancelled = false;
 
-    _wakeUpPipe[0] = -1;
-    _wakeUpPipe[1] = -1;
-
-    _pendingAdditions.clear();
-    _pendingRemovals.clear();
-    while (!_asyncFunctions.empty()) {
-        _asyncFunctions.pop();
+    // functions that were never invoked are cancelled, so that their handles can't affect the
+    // functions scheduled after the reset
+    std::vector<std::shared_ptr<Timer>> timers;
+    Submission submission;
+    while (_submissions.pop(&submission)) {
+        if (submission.type == Submission::Type::kAsync) {
+            timers.emplace_back(std::move(submission.timer));
+        }
     }
-}
+    _timers.clear(&timers);
 
-void RunLoop::_wakeUp() {
-    std::lock_guard<std::mutex> lk{_pipeMutex};
-    if (_wakeUpPipe[kWakeUpPipeInput] < 0) { return; }
-    if (_shouldWake.exchange(true)) {
-        // we set _shouldWake to true when we want to wake
-        // we set _shouldWake to false after waking, but before doing anything
-        // so if _shouldWake was already true, this method has already been called since the last wake-up, and
-        // writing to the pipe would be excessive
-        return;
+    for (auto& timer : timers) {
+        int expected = Timer::kPending;
+        if (timer->state.compare_exchange_strong(expected, Timer::kCancelled)) {
+            timer->func = nullptr;
+        }
     }
-    if (write(_wakeUpPipe[kWakeUpPipeInput], "!", 1) != 1) {
-        SCRAPS_LOGF_ERROR("error writing to wake up pipe (errno = %d)", static_cast<int>(errno));
+
+    if (_doorbell[kDoorbellOutput] >= 0) {
+        uint64_t buf[8];
+        while (read(_doorbell[kDoorbellOutput], buf, sizeof(buf)) > 0);
     }
 }
 
-void RunLoop::_processPendingAdditionsAndRemovals() {
-    std::lock_guard<std::mutex> lock{_mutex};
+std::chrono::steady_clock::time_point RunLoop::_deadline(std::chrono::steady_clock::duration delay) {
+    // functions without a delay are due immediately, even to flush
+    return delay.count() ? std::chrono::steady_clock::now() + delay : std::chrono::steady_clock::time_point::min();
+}
 
-    for (auto it = _pollDescriptors.begin(); !_pendingRemovals.empty() && it != _pollDescriptors.end(); ++it) {
-        if (_pendingRemovals.erase(it->fd)) {
-            *it = std::move(_pollDescriptors.back());
-            _pollDescriptors.pop_back();
-            continue;
-        }
-        auto pait = _pendingAdditions.find(it->fd);
-        if (pait != _pendingAdditions.end()) {
-            it->events = pait->second;
-            _pendingAdditions.erase(pait);
-        }
+void RunLoop::_submit(Submission submission) {
+    _submissions.push(std::move(submission));
+    _wakeUp();
+}
+
+void RunLoop::_wakeUp() {
+    // the loop clears _isBlocked after waking, so at most one producer rings per wait
+    if (!_isBlocked.exchange(false)) { return; }
+
+    uint64_t value = 1;
+    if (write(_doorbell[kDoorbellInput], &value, sizeof(value)) != sizeof(value) && errno != EAGAIN) {
+        SCRAPS_LOG_ERROR("error ringing doorbell (errno = {})", static_cast<int>(errno));
     }
+}
 
-    for (auto& kv : _pendingAdditions) {
-        bool existed = false;
-        for (auto& pfd : _pollDescriptors) {
-            if (pfd.fd == kv.first) {
-                existed = true;
-                pfd.events = kv.second;
+void RunLoop::_processSubmissions() {
+    Submission submission;
+    while (_submissions.pop(&submission)) {
+        switch (submission.type) {
+            case Submission::Type::kAsync:
+                if (submission.timer->state == Timer::kPending) {
+                    submission.timer->id = _timers.insert(submission.deadline, submission.timer);
+                }
+                break;
+            case Submission::Type::kReschedule:
+                _timers.reschedule(submission.timer->id, submission.deadline);
+                break;
+            case Submission::Type::kCancel:
+                _timers.erase(submission.timer->id);
+                break;
+            case Submission::Type::kAdd:
+                _poller->set(submission.fd, submission.events);
+                break;
+            case Submission::Type::kRemove:
+                _poller->remove(submission.fd);
                 break;
-            }
         }
-        if (!existed) {
-            _pollDescriptors.emplace_back();
-            auto& pfd = _pollDescriptors.back();
-            pfd.fd = kv.first;
-            pfd.events = kv.second;
+        submission.timer.reset();
+    }
+}
+
+bool RunLoop::_invokeExpiredTimers(std::chrono::steady_clock::time_point now) {
+    _timers.expire(now, &_expiredTimers);
+    if (_expiredTimers.empty()) { return false; }
+
+    // functions scheduled by these functions go through the submission queue, so they can't
+    // modify the wheel or this vector while we're iterating
+    for (auto& timer : _expiredTimers) {
+        int expected = Timer::kPending;
+        if (timer->state.compare_exchange_strong(expected, Timer::kInvoked)) {
+            auto func = std::move(timer->func);
+            timer->func = nullptr;
+            func();
         }
     }
 
-    _pendingAdditions.clear();
-    _pendingRemovals.clear();
+    _expiredTimers.clear();
+    return true;
 }
 
 } // namespace scraps
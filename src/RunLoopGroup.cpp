@@ -0,0 +1,102 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/RunLoopGroup.h>
+
+#include <scraps/logging.h>
+#include <scraps/thread.h>
+
+namespace scraps {
+
+namespace {
+thread_local const RunLoopGroup* gCurrentGroup = nullptr;
+thread_local size_t gCurrentIndex = 0;
+} // anonymous namespace
+
+RunLoopGroup::RunLoopGroup(size_t size, std::string name, bool pinThreads)
+    : _name{std::move(name)}
+    , _pinThreads{pinThreads}
+{
+    if (!size) {
+        size = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        _loops.emplace_back(std::make_unique<RunLoop>());
+    }
+}
+
+RunLoopGroup::~RunLoopGroup() {
+    stop();
+    wait();
+}
+
+void RunLoopGroup::start(std::function<void(size_t index)> onStarted, std::function<void(size_t index)> onStopped) {
+    stop();
+    wait();
+
+    for (size_t i = 0; i < _loops.size(); ++i) {
+        _loops[i]->reset();
+    }
+
+    for (size_t i = 0; i < _loops.size(); ++i) {
+        _threads.emplace_back([this, i, onStarted, onStopped] {
+            SetThreadName(_loops.size() > 1 ? _name + ' ' + std::to_string(i) : _name);
+
+            if (_pinThreads && !SetThreadAffinity(static_cast<unsigned>(i % std::max(std::thread::hardware_concurrency(), 1u)))) {
+                SCRAPS_LOG_WARNING("unable to pin run loop thread to cpu (index = {})", i);
+            }
+
+            gCurrentGroup = this;
+            gCurrentIndex = i;
+
+            if (onStarted) {
+                onStarted(i);
+            }
+
+            _loops[i]->run();
+
+            if (onStopped) {
+                onStopped(i);
+            }
+
+            _loops[i]->flush();
+
+            gCurrentGroup = nullptr;
+        });
+    }
+}
+
+void RunLoopGroup::stop() {
+    for (auto& loop : _loops) {
+        loop->cancel();
+    }
+}
+
+void RunLoopGroup::wait() {
+    for (auto& thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    _threads.clear();
+}
+
+stdts::optional<size_t> RunLoopGroup::currentIndex() const {
+    if (gCurrentGroup != this) { return stdts::nullopt; }
+    return gCurrentIndex;
+}
+
+} // namespace scraps
@@ -0,0 +1,264 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/TaskPool.h>
+
+#include <scraps/thread.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace scraps {
+
+namespace {
+thread_local const TaskPool* gCurrentPool = nullptr;
+thread_local size_t gCurrentWorker = 0;
+} // anonymous namespace
+
+TaskPool::TaskPool(size_t size, const std::string& threadName)
+    : _nextTimer{std::numeric_limits<std::chrono::steady_clock::rep>::max()}
+{
+    if (!size) {
+        size = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        _workers.emplace_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+        _threads.emplace_back([=] {
+            SetThreadName(size > 1 ? threadName + ' ' + std::to_string(i) : threadName);
+            gCurrentPool = this;
+            gCurrentWorker = i;
+            _run(i);
+        });
+    }
+}
+
+TaskPool::~TaskPool() {
+    cancelAndJoin();
+}
+
+void TaskPool::cancelAndJoin() {
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _exit = true;
+    }
+
+    _condVar.notify_all();
+    for (auto& thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    for (auto& worker : _workers) {
+        std::lock_guard<std::mutex> lock{worker->mutex};
+        worker->tasks.clear();
+    }
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    _timers.clear();
+    _updateNextTimer();
+}
+
+void TaskPool::_async(std::unique_ptr<Task> task) {
+    if (_exit) { return; }
+
+    if (!task->isDue()) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_exit) { return; }
+
+        auto t = task->time;
+        _timers.push_back(std::move(task));
+        std::push_heap(_timers.begin(), _timers.end(), TaskComparer{});
+
+        if (_timers.front()->time == t) {
+            _updateNextTimer();
+            // wakes the worker waiting for the previous timer, or an idle worker to wait for this one
+            _condVar.notify_all();
+        }
+        return;
+    }
+
+    _push(gCurrentPool == this ? gCurrentWorker : _nextWorker++ % _workers.size(), std::move(task));
+
+    // pairs with the idle workers incrementing _sleeping before checking _queued
+    if (_sleeping) {
+        { std::lock_guard<std::mutex> lock{_mutex}; }
+        _condVar.notify_one();
+    }
+}
+
+void TaskPool::_asyncBatch(std::vector<std::unique_ptr<Task>> tasks) {
+    if (_exit) { return; }
+
+    const auto now = std::chrono::steady_clock::now();
+    auto timed = std::partition(tasks.begin(), tasks.end(), [&](auto& task) { return task->time <= now; });
+    const size_t ready = timed - tasks.begin();
+
+    if (timed != tasks.end()) {
+        std::vector<std::unique_ptr<Task>> timers{std::make_move_iterator(timed), std::make_move_iterator(tasks.end())};
+        tasks.erase(timed, tasks.end());
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_exit) { return; }
+
+        auto next = _timers.empty() ? std::chrono::steady_clock::time_point::max() : _timers.front()->time;
+        _heapInsert(&_timers, &timers);
+        if (_timers.front()->time < next) {
+            _updateNextTimer();
+            _condVar.notify_all();
+        }
+    }
+
+    if (!ready) { return; }
+
+    // everything goes to a single worker. the rest will steal from it as they become available
+    auto& worker = *_workers[gCurrentPool == this ? gCurrentWorker : _nextWorker++ % _workers.size()];
+    {
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        worker.tasks.insert(worker.tasks.end(), std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()));
+    }
+    _queued += ready;
+
+    if (_sleeping) {
+        { std::lock_guard<std::mutex> lock{_mutex}; }
+        if (ready > 1) {
+            _condVar.notify_all();
+        } else {
+            _condVar.notify_one();
+        }
+    }
+}
+
+void TaskPool::_run(size_t index) {
+    while (!_exit) {
+        const auto nextTimer = _nextTimer.load(std::memory_order_relaxed);
+        if (nextTimer != std::numeric_limits<std::chrono::steady_clock::rep>::max()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now.time_since_epoch().count() >= nextTimer) {
+                std::lock_guard<std::mutex> lock{_mutex};
+                if (_promoteTimers(index, now) > 1 && _sleeping) {
+                    _condVar.notify_all();
+                }
+            }
+        }
+
+        if (auto task = _pop(index)) {
+            (*task)();
+            continue;
+        }
+
+        _idle(index);
+    }
+}
+
+void TaskPool::_push(size_t index, std::unique_ptr<Task> task) {
+    auto& worker = *_workers[index];
+    {
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        worker.tasks.push_back(std::move(task));
+    }
+    ++_queued;
+}
+
+std::unique_ptr<AbstractTaskScheduler::Task> TaskPool::_pop(size_t index) {
+    {
+        auto& worker = *_workers[index];
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        if (!worker.tasks.empty()) {
+            auto task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --_queued;
+            return task;
+        }
+    }
+
+    if (!_queued) { return nullptr; }
+
+    for (size_t i = 1; i < _workers.size(); ++i) {
+        auto& victim = *_workers[(index + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (!victim.tasks.empty()) {
+            auto task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --_queued;
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+void TaskPool::_idle(size_t index) {
+    std::unique_lock<std::mutex> lock{_mutex};
+
+    ++_sleeping;
+
+    auto hasWork = [&] { return _exit || _queued > 0; };
+
+    while (!hasWork()) {
+        if (auto count = _promoteTimers(index, std::chrono::steady_clock::now())) {
+            if (count > 1) {
+                _condVar.notify_all();
+            }
+            break;
+        }
+
+        if (_timers.empty() || _hasTimerWaiter) {
+            // a single worker waits for the next timer so that the others aren't all woken when it's due
+            _condVar.wait(lock, [&] { return hasWork() || (!_timers.empty() && !_hasTimerWaiter); });
+            continue;
+        }
+
+        _hasTimerWaiter = true;
+        const auto next = _timers.front()->time;
+        _condVar.wait_until(lock, next, [&] { return hasWork() || _timers.empty() || _timers.front()->time != next; });
+        _hasTimerWaiter = false;
+
+        if (!_timers.empty()) {
+            // let someone else take over if we're about to get busy
+            _condVar.notify_one();
+        }
+    }
+
+    --_sleeping;
+}
+
+size_t TaskPool::_promoteTimers(size_t index, std::chrono::steady_clock::time_point now) {
+    size_t count = 0;
+
+    while (!_timers.empty() && _timers.front()->time <= now) {
+        std::pop_heap(_timers.begin(), _timers.end(), TaskComparer{});
+        _push(index, std::move(_timers.back()));
+        _timers.pop_back();
+        ++count;
+    }
+
+    if (count) {
+        _updateNextTimer();
+    }
+
+    return count;
+}
+
+void TaskPool::_updateNextTimer() {
+    _nextTimer.store(_timers.empty() ? std::numeric_limits<std::chrono::steady_clock::rep>::max() : _timers.front()->time.time_since_epoch().count(),
+                     std::memory_order_relaxed);
+}
+
+} // namespace scraps
@@ -19,22 +19,45 @@ namespace scraps {
 
 void TaskQueue::clear() {
     std::lock_guard<std::mutex> lock{_mutex};
-    _tasks.clear();
+    _ready.clear();
+    _timers.clear();
 }
 
 void TaskQueue::_async(std::unique_ptr<Task> task) {
+    const auto isReady = task->isDue();
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (isReady) {
+        _ready.push_back(std::move(task));
+    } else {
+        _timers.push_back(std::move(task));
+        std::push_heap(_timers.begin(), _timers.end(), TaskComparer{});
+    }
+}
+
+void TaskQueue::_asyncBatch(std::vector<std::unique_ptr<Task>> tasks) {
+    const auto now = std::chrono::steady_clock::now();
+    auto timed = std::stable_partition(tasks.begin(), tasks.end(), [&](auto& task) { return task->time <= now; });
+
     std::lock_guard<std::mutex> lock{_mutex};
-    _tasks.push_back(std::move(task));
-    std::push_heap(_tasks.begin(), _tasks.end(), TaskComparer{});
+    _ready.insert(_ready.end(), std::make_move_iterator(tasks.begin()), std::make_move_iterator(timed));
+    tasks.erase(tasks.begin(), timed);
+    _heapInsert(&_timers, &tasks);
 }
 
 void TaskQueue::run() {
     std::unique_lock<std::mutex> lock{_mutex};
 
-    while (!_tasks.empty() && _tasks.front()->time <= std::chrono::steady_clock::now()) {
-        std::pop_heap(_tasks.begin(), _tasks.end(), TaskComparer{});
-        auto task = std::move(_tasks.back());
-        _tasks.pop_back();
+    const auto now = std::chrono::steady_clock::now();
+    while (!_timers.empty() && _timers.front()->time <= now) {
+        std::pop_heap(_timers.begin(), _timers.end(), TaskComparer{});
+        _ready.push_back(std::move(_timers.back()));
+        _timers.pop_back();
+    }
+
+    while (!_ready.empty()) {
+        auto task = std::move(_ready.front());
+        _ready.pop_front();
 
         lock.unlock();
         (*task)();
@@ -35,22 +35,58 @@ void TaskThread::cancelAndJoin() {
     if (_thread.joinable()) {
         _thread.join();
     }
-    _tasks.clear();
+    _ready.clear();
+    _timers.clear();
 }
 
 void TaskThread::_async(std::unique_ptr<Task> task) {
-    auto t = task->time;
-    auto firstElement = false;
+    auto notify = false;
+
+    if (task->isDue()) {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_exit) { return; }
+        _ready.push_back(std::move(task));
+        // if there were already ready tasks, the thread won't wait before running this one
+        notify = _ready.size() == 1;
+    } else {
+        auto t = task->time;
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (_exit) { return; }
+        _timers.push_back(std::move(task));
+        std::push_heap(_timers.begin(), _timers.end(), TaskComparer{});
+        notify = _timers.front()->time == t;
+    }
+
+    if (notify) {
+        _condVar.notify_one();
+    }
+}
+
+void TaskThread::_asyncBatch(std::vector<std::unique_ptr<Task>> tasks) {
+    if (tasks.empty()) { return; }
+
+    const auto now = std::chrono::steady_clock::now();
+    auto timed = std::stable_partition(tasks.begin(), tasks.end(), [&](auto& task) { return task->time <= now; });
+    auto notify = false;
 
     {
         std::lock_guard<std::mutex> lock{_mutex};
         if (_exit) { return; }
-        _tasks.push_back(std::move(task));
-        std::push_heap(_tasks.begin(), _tasks.end(), TaskComparer{});
-        firstElement = _tasks.front()->time == t;
+
+        if (timed != tasks.begin()) {
+            notify = _ready.empty();
+            _ready.insert(_ready.end(), std::make_move_iterator(tasks.begin()), std::make_move_iterator(timed));
+        }
+
+        if (timed != tasks.end()) {
+            tasks.erase(tasks.begin(), timed);
+            auto next = _timers.empty() ? std::chrono::steady_clock::time_point::max() : _timers.front()->time;
+            _heapInsert(&_timers, &tasks);
+            notify = notify || _timers.front()->time < next;
+        }
     }
 
-    if (firstElement) {
+    if (notify) {
         _condVar.notify_one();
     }
 }
@@ -59,17 +95,29 @@ void TaskThread::_run() {
     std::unique_lock<std::mutex> lock{_mutex};
 
     while (!_exit) {
-        if (_tasks.empty()) {
-            _condVar.wait(lock, [&]{ return _exit || !_tasks.empty(); });
-        } else {
-            auto next = _tasks.front()->time;
-            _condVar.wait_until(lock, next, [&]{ return _exit || _tasks.empty() || _tasks.front()->time != next; });
+        if (!_timers.empty()) {
+            const auto now = std::chrono::steady_clock::now();
+            while (!_timers.empty() && _timers.front()->time <= now) {
+                std::pop_heap(_timers.begin(), _timers.end(), TaskComparer{});
+                _ready.push_back(std::move(_timers.back()));
+                _timers.pop_back();
+            }
+        }
+
+        if (_ready.empty()) {
+            if (_timers.empty()) {
+                _condVar.wait(lock, [&]{ return _exit || !_ready.empty() || !_timers.empty(); });
+            } else {
+                auto next = _timers.front()->time;
+                _condVar.wait_until(lock, next, [&]{ return _exit || !_ready.empty() || _timers.front()->time != next; });
+            }
+            continue;
         }
 
-        while (!_exit && !_tasks.empty() && _tasks.front()->time <= std::chrono::steady_clock::now()) {
-            std::pop_heap(_tasks.begin(), _tasks.end(), TaskComparer{});
-            auto task = std::move(_tasks.back());
-            _tasks.pop_back();
+        // only run the tasks that are ready now, so that due timers get promoted between batches
+        for (auto n = _ready.size(); n && !_exit; --n) {
+            auto task = std::move(_ready.front());
+            _ready.pop_front();
 
             lock.unlock();
             (*task)();
@@ -0,0 +1,91 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/net/Resolver.h>
+
+#include <scraps/net/utility.h>
+
+#include <algorithm>
+
+namespace scraps::net {
+
+constexpr std::chrono::steady_clock::duration Resolver::kDefaultTTL;
+constexpr size_t Resolver::kDefaultMaxCacheEntries;
+
+Resolver::Resolver(size_t threads, std::chrono::steady_clock::duration ttl, size_t maxCacheEntries)
+    : _ttl{ttl}
+    , _maxCacheEntries{maxCacheEntries}
+    , _pool{std::max<size_t>(threads, 1), "Resolver"}
+{}
+
+void Resolver::resolve(const TaskScope& scope, const std::string& host, std::function<void(std::vector<Address>)> callback) {
+    if (auto addresses = cached(host)) {
+        callback(std::move(*addresses));
+        return;
+    }
+
+    _pool.async(scope, [this, host, callback = std::move(callback)] {
+        auto addresses = Resolve(host);
+        if (!addresses.empty()) {
+            _insert(host, addresses);
+        }
+        callback(std::move(addresses));
+    });
+}
+
+stdts::optional<std::vector<Address>> Resolver::cached(const std::string& host) {
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    auto it = _cache.find(host);
+    if (it == _cache.end()) {
+        return stdts::nullopt;
+    }
+
+    if (it->second.expiration <= std::chrono::steady_clock::now()) {
+        _cache.erase(it);
+        return stdts::nullopt;
+    }
+
+    return it->second.addresses;
+}
+
+void Resolver::clearCache() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    _cache.clear();
+}
+
+void Resolver::_insert(const std::string& host, std::vector<Address> addresses) {
+    if (!_maxCacheEntries) { return; }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    if (_cache.size() >= _maxCacheEntries && !_cache.count(host)) {
+        for (auto it = _cache.begin(); it != _cache.end();) {
+            it = it->second.expiration <= now ? _cache.erase(it) : std::next(it);
+        }
+        // still full of live entries. evicting an arbitrary one is good enough for a small cache
+        if (_cache.size() >= _maxCacheEntries) {
+            _cache.erase(_cache.begin());
+        }
+    }
+
+    auto& entry = _cache[host];
+    entry.addresses = std::move(addresses);
+    entry.expiration = now + _ttl;
+}
+
+} // namespace scraps::net
@@ -0,0 +1,58 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/net/SockAddr.h>
+
+namespace scraps::net {
+
+SockAddr::SockAddr(const Address& address, uint16_t port) {
+    if (address.is_v4()) {
+        _storage.v4.sin_family = AF_INET;
+#if SCRAPS_APPLE
+        // received addresses have their length set, and they should compare equal to this
+        _storage.v4.sin_len = sizeof(sockaddr_in);
+#endif
+        _storage.v4.sin_port = htons(port);
+        auto bytes = address.to_v4().to_bytes();
+        static_assert(sizeof(_storage.v4.sin_addr) == sizeof(bytes), "size mismatch");
+        memcpy(&_storage.v4.sin_addr, &bytes, sizeof(bytes));
+    } else if (address.is_v6()) {
+        auto v6 = address.to_v6();
+        _storage.v6.sin6_family = AF_INET6;
+#if SCRAPS_APPLE
+        _storage.v6.sin6_len = sizeof(sockaddr_in6);
+#endif
+        _storage.v6.sin6_port = htons(port);
+        _storage.v6.sin6_scope_id = static_cast<uint32_t>(v6.scope_id());
+        auto bytes = v6.to_bytes();
+        static_assert(sizeof(_storage.v6.sin6_addr) == sizeof(bytes), "size mismatch");
+        memcpy(&_storage.v6.sin6_addr, &bytes, sizeof(bytes));
+    }
+}
+
+Address SockAddr::address() const {
+    if (isV4()) {
+        asio::ip::address_v4::bytes_type bytes;
+        memcpy(&bytes, &_storage.v4.sin_addr, sizeof(bytes));
+        return asio::ip::address_v4(bytes);
+    } else if (isV6()) {
+        asio::ip::address_v6::bytes_type bytes;
+        memcpy(&bytes, &_storage.v6.sin6_addr, sizeof(bytes));
+        return asio::ip::address_v6(bytes, _storage.v6.sin6_scope_id);
+    }
+    return {};
+}
+
+} // namespace scraps::net
@@ -20,16 +20,49 @@
 #include <scraps/net/Endpoint.h>
 #include <scraps/net/utility.h>
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
 #include <strings.h>
 
+#include <algorithm>
+#include <climits>
 #include <thread>
+#include <utility>
 
 namespace scraps::net {
 
+namespace {
+
+// limits on how much of a connection's send queue is coalesced into a single call
+constexpr size_t kMaxSendBuffers = IOV_MAX;
+constexpr size_t kMaxSendBytes = 256 * 1024;
+
+// drained send queues keep enough capacity for typical bursts without pinning memory to idle
+// connections
+constexpr size_t kMaxRetainedSendQueueCapacity = 16;
+
+constexpr size_t kReceiveBufferSize = 16 * 1024;
+constexpr size_t kMaxReceiveBuffers = 64;
+
+// counters are only written by a single thread, so they don't need atomic read-modify-writes
+void Increment(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+constexpr size_t TCPService::ConnectionTable::kChunkSize;
+constexpr size_t TCPService::ConnectionTable::kMaxChunks;
+constexpr std::chrono::steady_clock::duration TCPService::kTimeoutResolution;
+constexpr int TCPService::kDefaultListenBacklog;
+constexpr size_t TCPService::kAcceptBatchSize;
+constexpr size_t TCPService::kDefaultReceiveBudget;
+constexpr size_t TCPService::kDefaultSendQueueLowWaterMark;
+constexpr size_t TCPService::kDefaultSendQueueHighWaterMark;
+
 TCPService::Connection::~Connection() {
     close();
     if (fd >= 0) {
@@ -54,56 +87,261 @@ bool TCPService::Connection::close() {
     return true;
 }
 
+TCPService::ConnectionTable::ConnectionTable(size_t shardIndex, size_t shardCount)
+    : _shardIndex{shardIndex}
+    , _shardCount{shardCount}
+    , _chunks{new std::atomic<Slot*>[kMaxChunks]}
+{
+    for (size_t i = 0; i < kMaxChunks; ++i) {
+        _chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TCPService::ConnectionTable::~ConnectionTable() {
+    for (size_t i = 0; i < kMaxChunks; ++i) {
+        delete[] _chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+TCPService::ConnectionId TCPService::ConnectionTable::reserve() {
+    std::lock_guard<std::mutex> lock{_mutex};
+
+    uint32_t index;
+    if (!_freeSlots.empty()) {
+        index = _freeSlots.back();
+        _freeSlots.pop_back();
+    } else {
+        // ids are 32 bits of generation and 32 bits of slot and shard index
+        if (_slotCount >= kChunkSize * kMaxChunks || static_cast<uint64_t>(_slotCount) * _shardCount + _shardIndex + 1 > 0xffffffff) {
+            SCRAPS_LOG_ERROR("too many connections");
+            return 0;
+        }
+        index = _slotCount++;
+        if (index % kChunkSize == 0) {
+            _chunks[index / kChunkSize].store(new Slot[kChunkSize], std::memory_order_release);
+        }
+    }
+
+    return static_cast<ConnectionId>(_slot(index).generation) << 32 | (index * _shardCount + _shardIndex + 1);
+}
+
+void TCPService::ConnectionTable::release(ConnectionId connectionId) {
+    auto slot = _find(connectionId);
+    if (!slot || slot->connection) { return; }
+
+    auto index = static_cast<uint32_t>(((connectionId & 0xffffffff) - 1) / _shardCount);
+    ++slot->generation;
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    _freeSlots.push_back(index);
+}
+
+TCPService::Connection& TCPService::ConnectionTable::emplace(ConnectionId connectionId, int fd, Connection::State state) {
+    auto slot = _find(connectionId);
+    assert(slot && !slot->connection);
+
+    slot->connection.emplace(connectionId, fd, state);
+    ++_size;
+
+    if (static_cast<size_t>(fd) >= _fdSlots.size()) {
+        _fdSlots.resize(fd + 1);
+    }
+    _fdSlots[fd] = static_cast<uint32_t>(((connectionId & 0xffffffff) - 1) / _shardCount) + 1;
+
+    return *slot->connection;
+}
+
+void TCPService::ConnectionTable::erase(Connection& connection) {
+    auto slot = _find(connection.id);
+    assert(slot && &*slot->connection == &connection);
+
+    auto id = connection.id;
+    connection.close();
+    _fdSlots[connection.fd] = 0;
+    slot->connection = stdts::nullopt;
+    --_size;
+
+    release(id);
+}
+
+void TCPService::ConnectionTable::setFd(Connection& connection, int fd) {
+    auto index = _fdSlots[connection.fd];
+    _fdSlots[connection.fd] = 0;
+
+    if (static_cast<size_t>(fd) >= _fdSlots.size()) {
+        _fdSlots.resize(fd + 1);
+    }
+    _fdSlots[fd] = index;
+
+    connection.fd = fd;
+}
+
+TCPService::Connection* TCPService::ConnectionTable::findById(ConnectionId connectionId) const {
+    auto slot = _find(connectionId);
+    return slot && slot->connection ? &*slot->connection : nullptr;
+}
+
+TCPService::ConnectionTable::Slot* TCPService::ConnectionTable::_find(ConnectionId connectionId) const {
+    auto bits = connectionId & 0xffffffff;
+    if (!bits || (bits - 1) % _shardCount != _shardIndex) { return nullptr; }
+
+    auto index = (bits - 1) / _shardCount;
+    if (index >= kChunkSize * kMaxChunks) { return nullptr; }
+
+    auto chunk = _chunks[index / kChunkSize].load(std::memory_order_acquire);
+    if (!chunk) { return nullptr; }
+
+    auto& slot = chunk[index % kChunkSize];
+    return slot.generation == (connectionId >> 32) ? &slot : nullptr;
+}
+
+struct TCPService::AcceptedConnection {
+    AcceptedConnection(TCPService& service, Shard& shard, ConnectionId id, int fd) : service{service}, shard{shard}, id{id}, fd{fd} {}
+
+    // if the handoff never ran, e.g. because the loop stopped first, the connection is discarded
+    ~AcceptedConnection() {
+        if (fd >= 0) {
+            service._discardAcceptedConnection(shard, id, fd);
+        }
+    }
+
+    TCPService& service;
+    Shard& shard;
+    const ConnectionId id;
+    int fd;
+};
+
+struct TCPService::PendingConnection {
+    PendingConnection(TCPService& service, Shard& shard, ConnectionId id) : service{service}, shard{shard}, id{id} {}
+
+    // if the shard never got to it, e.g. because the loop stopped first, the connection fails
+    ~PendingConnection() {
+        if (id) {
+            service._discardPendingConnection(shard, id);
+        }
+    }
+
+    TCPService& service;
+    Shard& shard;
+    ConnectionId id;
+};
+
+TCPService::TCPService(TCPServiceDelegate* delegate, RunLoopGroup* group)
+    : _delegate{delegate}
+    , _ownedGroup{group ? nullptr : std::make_unique<RunLoopGroup>(1, typeid(*delegate).name())}
+    , _group{group ? group : _ownedGroup.get()}
+{
+    for (size_t i = 0; i < _group->size(); ++i) {
+        _shards.emplace_back(std::make_unique<Shard>(i, _group->size(), _group->loop(i)));
+    }
+}
+
 TCPService::~TCPService() {
+    // blocks until any in-progress resolution callbacks return
+    _resolveScope.endScope();
+
     stop();
     wait();
+
+    for (auto& shard : _shards) {
+        // drops anything that was queued after the loop stopped, such as connection handoffs,
+        // while the service is still around to clean up after them
+        shard->runLoop.reset();
+
+        if (shard->listenFD >= 0) {
+            ::close(shard->listenFD);
+        }
+    }
 }
 
-bool TCPService::bind(const std::string& interface, uint16_t port) {
-    struct sockaddr_in addr;
-    bzero(&addr, sizeof(addr));
-    addr.sin_family = AF_INET;
-    if (::inet_pton(addr.sin_family, interface.c_str(), &addr.sin_addr.s_addr) <= 0) {
+bool TCPService::bind(const std::string& interface, uint16_t port, int backlog) {
+    asio::error_code ec;
+    Address address = Address::from_string(interface, ec);
+    if (ec) {
         SCRAPS_LOG_ERROR("invalid interface");
         return false;
     }
-    addr.sin_port = htons(port);
 
-    auto fd = ::socket(addr.sin_family, SOCK_STREAM, 0);
-    if (fd < 0) {
-        SCRAPS_LOG_ERROR("error opening socket (errno = {})", static_cast<int>(errno));
-        return false;
-    }
+    sockaddr_storage addr;
+    socklen_t addrLength;
+    Endpoint{address, port}.getSockAddr(&addr, &addrLength);
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    // linux distributes connections between SO_REUSEPORT listeners. elsewhere, the option
+    // exists but typically all connections go to a single listener
+    const size_t listeners = _shards.size();
+#else
+    const size_t listeners = 1;
+#endif
+
+    _listeners = listeners;
+
+    for (size_t i = 0; i < listeners; ++i) {
+        auto fd = ::socket(addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            SCRAPS_LOG_ERROR("error opening socket (errno = {})", static_cast<int>(errno));
+            return false;
+        }
 
-    int reuse = 1;
-    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
 
-    if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        SCRAPS_LOG_ERROR("error binding socket (errno = {})", static_cast<int>(errno));
-        ::close(fd);
-        return false;
-    }
+#ifdef SO_REUSEPORT
+        if (listeners > 1 && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+            SCRAPS_LOG_ERROR("error enabling port reuse (errno = {})", static_cast<int>(errno));
+            ::close(fd);
+            return false;
+        }
+#endif
 
-    if (!SetBlocking(fd, false)) {
-        SCRAPS_LOG_ERROR("couldn't make socket non-blocking");
-        ::close(fd);
-        return false;
-    }
+        if (addr.ss_family == AF_INET6) {
+            // when bound to "::", accept ipv4 connections as well
+            int v6only = 0;
+            if (::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) < 0) {
+                SCRAPS_LOG_WARNING("unable to disable IPV6_V6ONLY (errno = {})", static_cast<int>(errno));
+            }
+        }
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), addrLength) < 0) {
+            SCRAPS_LOG_ERROR("error binding socket (errno = {})", static_cast<int>(errno));
+            ::close(fd);
+            return false;
+        }
 
-    ::listen(fd, 20);
-    _listenFD = fd;
+        if (!SetBlocking(fd, false)) {
+            SCRAPS_LOG_ERROR("couldn't make socket non-blocking");
+            ::close(fd);
+            return false;
+        }
+
+        if (::listen(fd, backlog) < 0) {
+            SCRAPS_LOG_ERROR("error listening on socket (errno = {})", static_cast<int>(errno));
+            ::close(fd);
+            return false;
+        }
+
+        _shards[i]->listenFD = fd;
+
+        if (i == 0) {
+            // the remaining listeners need to use the same port, which may have been chosen by
+            // the operating system
+            Endpoint{address, this->port()}.getSockAddr(&addr, &addrLength);
+        }
+    }
 
     return true;
 }
 
 uint16_t TCPService::port() const {
-    struct sockaddr_in addr;
+    sockaddr_storage addr;
     socklen_t saLen = sizeof(addr);
-    int rc = ::getsockname(_listenFD, reinterpret_cast<struct sockaddr*>(&addr), &saLen);
-    if (rc == 0) {
-        return ntohs(addr.sin_port);
-    } else {
+    int rc = ::getsockname(_shards[0]->listenFD, reinterpret_cast<sockaddr*>(&addr), &saLen);
+    if (rc != 0) {
         return 0;
+    } else if (addr.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
+    } else {
+        return ntohs(reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
     }
 }
 
@@ -111,143 +349,253 @@ void TCPService::start() {
     stop();
     wait();
 
-    _runLoop.reset();
-    _runLoop.setEventHandler([&](int fd, short events) {
-        _eventHandler(fd, events);
-    });
-
-    if (_listenFD != -1) {
-        _runLoop.async([this] {
-            _runLoop.add(_listenFD, POLLIN);
+    for (auto& shard : _shards) {
+        shard->runLoop.setEventHandler([this, shard = shard.get()](int fd, short events) {
+            _eventHandler(*shard, fd, events);
         });
     }
 
-    _thread = std::thread([&] {
-        SetThreadName(typeid(*_delegate).name());
-
-        _runLoop.run();
-
-        while (!_connections.empty()) {
-            _closeAndErase(*_connections.front());
-        }
-
-        if (_listenFD >= 0) {
-            _runLoop.remove(_listenFD);
-            ::close(_listenFD);
-            _listenFD = -1;
+    _group->start([this](size_t index) {
+        auto& shard = *_shards[index];
+        shard.isStopping = false;
+        if (shard.listenFD != -1) {
+            shard.runLoop.add(shard.listenFD, POLLIN);
         }
-
-        _runLoop.flush();
+    }, [this](size_t index) {
+        auto& shard = *_shards[index];
+        shard.isStopping = true;
+        _closeAll(shard);
     });
 }
 
 void TCPService::stop() {
-    _runLoop.cancel();
+    _group->stop();
 }
 
 void TCPService::wait() const {
-    if (_thread.joinable()) {
-        _thread.join();
-    }
+    _group->wait();
 }
 
-void TCPService::async(const std::function<void()>& function, std::chrono::milliseconds delay) {
-    _runLoop.async(function, delay);
+RunLoop::TimerHandle TCPService::async(const std::function<void()>& function, std::chrono::steady_clock::duration delay) {
+    return _shards[0]->runLoop.async(function, delay);
+}
+
+RunLoop::TimerHandle TCPService::async(ConnectionId connectionId, const std::function<void()>& function, std::chrono::steady_clock::duration delay) {
+    return _shard(connectionId).runLoop.async(function, delay);
 }
 
 bool TCPService::isCurrentThread() const {
-    return std::this_thread::get_id() == _thread.get_id();
+    return _group->isCurrentThread();
 }
 
 TCPService::ConnectionId TCPService::connect(sockaddr* address, size_t addressLength) {
-    ConnectionId id = ++_connectionIdCounter;
+    auto& shard = _nextConnectionShard();
+    ConnectionId id = shard.connections.reserve();
+    if (!id) { return 0; }
 
     sockaddr_storage addressStorage;
     memcpy(&addressStorage, address, addressLength);
 
-    _runLoop.async([this, id, addressStorage, addressLength] {
-        _connect(id, reinterpret_cast<const sockaddr*>(&addressStorage), addressLength);
+    auto connection = std::make_shared<PendingConnection>(*this, shard, id);
+    shard.runLoop.async([this, &shard, connection, addressStorage, addressLength] {
+        _connect(shard, std::exchange(connection->id, 0), reinterpret_cast<const sockaddr*>(&addressStorage), addressLength);
     });
 
     return id;
 }
 
 TCPService::ConnectionId TCPService::connect(const std::string& host, uint16_t port) {
-    ConnectionId id = ++_connectionIdCounter;
-
-    _runLoop.async([this, host, port, id] {
-        auto addresses = ResolveIPv4(host);
-        if (addresses.empty()) {
-            SCRAPS_LOG_ERROR("unable to resolve host {}", host);
-            return;
-        }
-        Endpoint endpoint{addresses[UniformDistribution(0u, addresses.size() - 1, _prng)], port};
+    asio::error_code ec;
+    Address address = Address::from_string(host, ec);
+    if (!ec) {
         sockaddr_storage addr;
         socklen_t addrLength;
-        endpoint.getSockAddr(&addr, &addrLength);
-        _connect(id, reinterpret_cast<sockaddr*>(&addr), addrLength);
+        Endpoint{address, port}.getSockAddr(&addr, &addrLength);
+        return connect(reinterpret_cast<sockaddr*>(&addr), addrLength);
+    }
+
+    auto& shard = _nextConnectionShard();
+    ConnectionId id = shard.connections.reserve();
+    if (!id) { return 0; }
+
+    // resolve off of the loop so that other connections aren't held up
+    auto connection = std::make_shared<PendingConnection>(*this, shard, id);
+    resolver()->resolve(_resolveScope, host, [this, &shard, host, port, connection](std::vector<Address> addresses) mutable {
+        // the loop's task becomes the only owner, so the id is released either by the loop or
+        // while the loop is reset
+        shard.runLoop.async([this, &shard, host, port, connection = std::move(connection), addresses = std::move(addresses)] {
+            auto id = std::exchange(connection->id, 0);
+            if (addresses.empty()) {
+                SCRAPS_LOG_ERROR("unable to resolve host {}", host);
+                shard.connections.release(id);
+                _delegate->tcpServiceConnectionFailed(id);
+                return;
+            }
+
+            // either family's connectivity may be broken, so alternate between them, starting with
+            // ipv4. each family is shuffled to spread connections across the host's addresses
+            std::vector<Address> v4, v6;
+            for (auto& address : addresses) {
+                (address.is_v4() ? v4 : v6).push_back(address);
+            }
+            std::shuffle(v4.begin(), v4.end(), shard.prng);
+            std::shuffle(v6.begin(), v6.end(), shard.prng);
+
+            std::vector<Endpoint> candidates;
+            for (size_t i = 0; i < std::max(v4.size(), v6.size()); ++i) {
+                if (i < v4.size()) { candidates.emplace_back(v4[i], port); }
+                if (i < v6.size()) { candidates.emplace_back(v6[i], port); }
+            }
+            _connect(shard, id, std::move(candidates));
+        });
     });
 
     return id;
 }
 
-void TCPService::send(TCPService::ConnectionId connectionId, const void* data, size_t length) {
-    auto buffer = std::make_shared<Connection::SendBuffer>();
-    buffer->data.assign(static_cast<const char*>(data), length);
+void TCPService::setResolver(std::shared_ptr<Resolver> resolver) {
+    std::lock_guard<std::mutex> lock{_resolverMutex};
+    _resolver = std::move(resolver);
+}
 
-    _runLoop.async([this, connectionId, buffer] {
-        auto connection = _connections.findById(connectionId);
-        if (!connection) { return; }
+std::shared_ptr<Resolver> TCPService::resolver() {
+    std::lock_guard<std::mutex> lock{_resolverMutex};
+    if (!_resolver) {
+        _resolver = std::make_shared<Resolver>(1);
+    }
+    return _resolver;
+}
+
+bool TCPService::send(TCPService::ConnectionId connectionId, const void* data, size_t length) {
+    // checked here as well so that rejected data isn't copied
+    if (_queuedBytes + length > _maxQueuedBytes) {
+        ++_sendsRejected;
+        return false;
+    }
+
+    return send(connectionId, std::make_shared<const std::string>(static_cast<const char*>(data), length));
+}
 
-        if (connection->isClosing()) { return; }
+bool TCPService::send(TCPService::ConnectionId connectionId, const void* data, size_t length, std::shared_ptr<const void> owner) {
+    if (!_reserveQueuedBytes(length)) { return false; }
 
-        connection->sendQueue.push(buffer);
+    Connection::SendBuffer buffer;
+    buffer.owner = std::move(owner);
+    buffer.data = static_cast<const char*>(data);
+    buffer.length = length;
 
-        _trySend(*connection);
+    auto& shard = _shard(connectionId);
+    shard.runLoop.async([this, &shard, connectionId, buffer] {
+        _send(shard, connectionId, buffer);
     });
+
+    return true;
+}
+
+bool TCPService::send(const std::vector<ConnectionId>& connectionIds, std::shared_ptr<const std::string> data) {
+    if (!_reserveQueuedBytes(data->size() * connectionIds.size())) { return false; }
+
+    std::vector<std::vector<ConnectionId>> connectionIdsByShard(_shards.size());
+    for (auto connectionId : connectionIds) {
+        connectionIdsByShard[_shard(connectionId).index].push_back(connectionId);
+    }
+
+    Connection::SendBuffer buffer;
+    buffer.data = data->data();
+    buffer.length = data->size();
+    buffer.owner = std::move(data);
+
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        if (connectionIdsByShard[i].empty()) { continue; }
+
+        auto& shard = *_shards[i];
+        shard.runLoop.async([this, &shard, connectionIds = std::move(connectionIdsByShard[i]), buffer] {
+            for (auto connectionId : connectionIds) {
+                _send(shard, connectionId, buffer);
+            }
+        });
+    }
+
+    return true;
+}
+
+bool TCPService::_reserveQueuedBytes(size_t bytes) {
+    if (_queuedBytes.fetch_add(bytes) + bytes > _maxQueuedBytes) {
+        _queuedBytes -= bytes;
+        ++_sendsRejected;
+        return false;
+    }
+    return true;
+}
+
+TCPService::Stats TCPService::stats() const {
+    Stats stats;
+    stats.bytesQueued = _queuedBytes;
+    stats.sendsRejected = _sendsRejected;
+    for (auto& shard : _shards) {
+        stats.sendCalls += shard->sendCalls.load(std::memory_order_relaxed);
+        stats.sendBuffers += shard->sendBuffers.load(std::memory_order_relaxed);
+        stats.bytesSent += shard->bytesSent.load(std::memory_order_relaxed);
+        stats.receiveWakeups += shard->receiveWakeups.load(std::memory_order_relaxed);
+        stats.receiveCalls += shard->receiveCalls.load(std::memory_order_relaxed);
+        stats.bytesReceived += shard->bytesReceived.load(std::memory_order_relaxed);
+        stats.receiveBudgetExhausted += shard->receiveBudgetExhausted.load(std::memory_order_relaxed);
+        stats.acceptWakeups += shard->acceptWakeups.load(std::memory_order_relaxed);
+        stats.connectionsAccepted += shard->connectionsAccepted.load(std::memory_order_relaxed);
+        stats.acceptErrors += shard->acceptErrors.load(std::memory_order_relaxed);
+        stats.acceptBatchExhausted += shard->acceptBatchExhausted.load(std::memory_order_relaxed);
+        stats.connectionsRejected += shard->connectionsRejected.load(std::memory_order_relaxed);
+        stats.connectionsTimedOut += shard->connectionsTimedOut.load(std::memory_order_relaxed);
+    }
+    return stats;
 }
 
 void TCPService::close(TCPService::ConnectionId connectionId) {
     SCRAPS_LOG_INFO("closing tcp connection (id = {})", connectionId);
 
-    _runLoop.async([this, connectionId] {
-        auto connection = _connections.findById(connectionId);
+    auto& shard = _shard(connectionId);
+    shard.runLoop.async([this, &shard, connectionId] {
+        auto connection = shard.connections.findById(connectionId);
         if (!connection) { return; }
 
         if (!connection->close()) {
-            _closeAndErase(*connection);
+            _closeAndErase(shard, *connection);
         }
     });
 }
 
-void TCPService::_eventHandler(int fd, short events) {
-    if (fd == _listenFD) {
-        // TODO: limit or filter our connections instead of blindly accepting everything?
-        auto newFD = accept(fd, nullptr, nullptr);
-        if (newFD < 0) {
-            SCRAPS_LOG_ERROR("error accepting connection");
-            return;
-        }
-        if (!SetBlocking(newFD, false)) {
-            SCRAPS_LOG_ERROR("couldn't make socket non-blocking");
-            ::close(newFD);
-            return;
-        }
-        SCRAPS_LOG_INFO("accepted connection (fd = {})", newFD);
-        _runLoop.add(newFD, POLLIN | POLLOUT | POLLHUP);
-        auto id = ++_connectionIdCounter;
-        _connections.emplace(id, newFD, Connection::kConnected);
-        _delegate->tcpServiceConnectionEstablished(id);
+void TCPService::_eventHandler(Shard& shard, int fd, short events) {
+    if (fd == shard.listenFD) {
+        _accept(shard);
         return;
     }
 
-    auto connection = _connections.findByFd(fd);
+    auto connection = shard.connections.findByFd(fd);
     if (!connection) {
         // file descriptor is already closed...remove it from the run loop
-        _runLoop.remove(fd);
+        shard.runLoop.remove(fd);
         return;
     }
 
+    if (connection->isConnecting() && (events & (POLLOUT | POLLHUP | POLLERR))) {
+        int err = 0;
+        socklen_t errSize = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errSize) < 0 || err || (events & (POLLHUP | POLLERR))) {
+            SCRAPS_LOG_INFO("connection failed (fd = {}, err = {})", fd, err);
+            if (!_connectNextCandidate(shard, *connection)) {
+                _closeAndErase(shard, *connection);
+            }
+            return;
+        }
+
+        SCRAPS_LOG_INFO("connection established (fd = {})", fd);
+        connection->state = Connection::kConnected;
+        connection->connectCandidates = std::vector<Endpoint>{};
+        connection->lastReceive = connection->lastSend = std::chrono::steady_clock::now();
+        _updateTimeout(shard, *connection);
+        _delegate->tcpServiceConnectionEstablished(connection->id);
+    }
+
     if ((events & POLLHUP) || (connection->isClosing() && (events & POLLIN))) {
         // finishing up a graceful shutdown
         SCRAPS_LOG_INFO("connection closed (fd = {})", fd);
@@ -255,53 +603,145 @@ void TCPService::_eventHandler(int fd, short events) {
         shutdown(fd, SHUT_WR);
         recv(fd, nullptr, 0, 0);
 
-        _closeAndErase(*connection);
+        _closeAndErase(shard, *connection);
         return;
     }
 
     if (events & POLLOUT) {
-        if (connection->isConnecting()) {
-            int err = 0;
-            socklen_t errSize = sizeof(err);
-            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errSize) < 0 || err) {
-                SCRAPS_LOG_INFO("connection failed (fd = {}, err = {})", fd, err);
-                _delegate->tcpServiceConnectionFailed(connection->id);
-            } else {
-                SCRAPS_LOG_INFO("connection established (fd = {})", fd);
-                connection->state = Connection::kConnected;
-                _delegate->tcpServiceConnectionEstablished(connection->id);
-            }
-        }
-
-        _trySend(*connection);
+        if (!_trySend(shard, *connection)) { return; }
     }
 
     if (events & POLLIN) {
-        while (true) {
-            char buf[500];
-            auto bytes = recv(fd, buf, sizeof(buf), 0);
+        _receive(shard, *connection);
+    }
+}
 
-            if (bytes < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
-                break;
+void TCPService::_accept(Shard& shard) {
+    Increment(shard.acceptWakeups);
+
+    for (size_t i = 0; i < kAcceptBatchSize; ++i) {
+        sockaddr_storage peer;
+        socklen_t peerLength = sizeof(peer);
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+        auto newFD = accept4(shard.listenFD, reinterpret_cast<sockaddr*>(&peer), &peerLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        auto newFD = accept(shard.listenFD, reinterpret_cast<sockaddr*>(&peer), &peerLength);
+#endif
+        if (newFD < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                return;
             }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            SCRAPS_LOG_ERROR("error accepting connection (errno = {})", static_cast<int>(errno));
+            Increment(shard.acceptErrors);
+            // e.g. EMFILE. the connection stays pending, so give other work a chance before retrying
+            return;
+        }
+
+#if !SCRAPS_LINUX && !SCRAPS_ANDROID
+        if (!SetBlocking(newFD, false)) {
+            SCRAPS_LOG_ERROR("couldn't make socket non-blocking");
+            ::close(newFD);
+            continue;
+        }
+        fcntl(newFD, F_SETFD, FD_CLOEXEC);
+#endif
 
-            if (bytes <= 0) {
-                if (bytes < 0) {
-                    SCRAPS_LOG_ERROR("socket error (fd = {}, errno = {})", fd, static_cast<int>(errno));
-                } else {
-                    SCRAPS_LOG_INFO("closing connection (fd = {})", fd);
-                }
+        // accepting and closing refused connections keeps them from filling up the backlog
+        if (!_delegate->tcpServiceShouldAcceptConnection(reinterpret_cast<sockaddr*>(&peer), peerLength)) {
+            SCRAPS_LOG_INFO("refused connection (fd = {})", newFD);
+            Increment(shard.connectionsRejected);
+            ::close(newFD);
+            continue;
+        }
 
-                _closeAndErase(*connection);
-                return;
-            }
+        if (_openConnections++ >= _maxConnections) {
+            --_openConnections;
+            SCRAPS_LOG_WARNING("refused connection because of the connection limit (fd = {})", newFD);
+            Increment(shard.connectionsRejected);
+            ::close(newFD);
+            continue;
+        }
 
-            _delegate->tcpServiceConnectionReceivedData(connection->id, buf, static_cast<size_t>(bytes));
+        SCRAPS_LOG_INFO("accepted connection (fd = {})", newFD);
+        Increment(shard.connectionsAccepted);
+        _configureSocket(newFD);
+
+        // with per-shard listeners, the kernel has already balanced the connections
+        auto& target = _listeners < _shards.size() ? _nextConnectionShard() : shard;
+        auto id = target.connections.reserve();
+        if (!id) {
+            --_openConnections;
+            ::close(newFD);
+            continue;
+        }
+
+        if (&target == &shard) {
+            _addAcceptedConnection(shard, id, newFD);
+        } else {
+            auto connection = std::make_shared<AcceptedConnection>(*this, target, id, newFD);
+            target.runLoop.async([this, connection] {
+                _addAcceptedConnection(connection->shard, connection->id, std::exchange(connection->fd, -1));
+            });
         }
     }
+
+    // the listener is level-triggered, so we'll be woken up again for the rest
+    Increment(shard.acceptBatchExhausted);
 }
 
-void TCPService::_connect(TCPService::ConnectionId connectionId, const sockaddr* address, size_t addressLength) {
+void TCPService::_addAcceptedConnection(Shard& shard, ConnectionId connectionId, int fd) {
+    if (shard.isStopping) {
+        // the shard's connections have already been closed
+        _discardAcceptedConnection(shard, connectionId, fd);
+        return;
+    }
+
+    shard.runLoop.add(fd, POLLIN | POLLOUT | POLLHUP);
+    auto& connection = shard.connections.emplace(connectionId, fd, Connection::kConnected);
+    connection.lastReceive = connection.lastSend = std::chrono::steady_clock::now();
+    _updateTimeout(shard, connection);
+    _delegate->tcpServiceConnectionEstablished(connectionId);
+}
+
+void TCPService::_discardAcceptedConnection(Shard& shard, ConnectionId connectionId, int fd) {
+    SCRAPS_LOG_INFO("discarding accepted connection (fd = {})", fd);
+    ::close(fd);
+    shard.connections.release(connectionId);
+    --_openConnections;
+}
+
+void TCPService::_discardPendingConnection(Shard& shard, ConnectionId connectionId) {
+    SCRAPS_LOG_INFO("discarding pending connection (id = {})", connectionId);
+    shard.connections.release(connectionId);
+    _delegate->tcpServiceConnectionFailed(connectionId);
+}
+
+void TCPService::_connect(Shard& shard, TCPService::ConnectionId connectionId, const sockaddr* address, size_t addressLength) {
+    auto s = _openConnectingSocket(address, addressLength);
+    if (s < 0) {
+        shard.connections.release(connectionId);
+        _delegate->tcpServiceConnectionFailed(connectionId);
+        return;
+    }
+
+    _addConnectingSocket(shard, connectionId, s);
+}
+
+void TCPService::_connect(Shard& shard, TCPService::ConnectionId connectionId, std::vector<Endpoint> candidates) {
+    auto s = _openConnectingSocket(candidates);
+    if (s < 0) {
+        shard.connections.release(connectionId);
+        _delegate->tcpServiceConnectionFailed(connectionId);
+        return;
+    }
+
+    _addConnectingSocket(shard, connectionId, s).connectCandidates = std::move(candidates);
+}
+
+int TCPService::_openConnectingSocket(const sockaddr* address, size_t addressLength) {
     auto s = socket(address->sa_family, SOCK_STREAM, 0);
 
     if (s < 0) {
@@ -316,63 +756,270 @@ void TCPService::_connect(TCPService::ConnectionId connectionId, const sockaddr*
         s = -1;
     }
 
-    int one = 1;
-    if (s >= 0 && setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0) {
-        SCRAPS_LOG_WARNING("unable to set TCP_NODELAY on socket (errno = {})", static_cast<int>(errno));
+    if (s >= 0) {
+        _configureSocket(s);
     }
 
-    if (s < 0) {
-        _delegate->tcpServiceConnectionFailed(connectionId);
+    return s;
+}
+
+int TCPService::_openConnectingSocket(std::vector<Endpoint>& candidates) {
+    while (!candidates.empty()) {
+        sockaddr_storage addr;
+        socklen_t addrLength;
+        candidates.front().getSockAddr(&addr, &addrLength);
+        candidates.erase(candidates.begin());
+
+        auto s = _openConnectingSocket(reinterpret_cast<sockaddr*>(&addr), addrLength);
+        if (s >= 0) {
+            return s;
+        }
+    }
+
+    return -1;
+}
+
+TCPService::Connection& TCPService::_addConnectingSocket(Shard& shard, ConnectionId connectionId, int fd) {
+    auto& connection = shard.connections.emplace(connectionId, fd, Connection::kConnecting);
+    ++_openConnections;
+
+    // the connect timeout is measured from here
+    connection.lastReceive = connection.lastSend = std::chrono::steady_clock::now();
+    _updateTimeout(shard, connection);
+
+    shard.runLoop.add(fd, POLLIN | POLLOUT | POLLHUP);
+    return connection;
+}
+
+bool TCPService::_connectNextCandidate(Shard& shard, Connection& connection) {
+    if (connection.connectCandidates.empty()) { return false; }
+
+    auto s = _openConnectingSocket(connection.connectCandidates);
+    if (s < 0) { return false; }
+
+    SCRAPS_LOG_INFO("trying the next address (fd = {}, previous fd = {})", s, connection.fd);
+
+    shard.runLoop.remove(connection.fd);
+    ::close(connection.fd);
+    shard.connections.setFd(connection, s);
+
+    // each address gets the full connect timeout. if the timeout entry is already later than
+    // this, it's reevaluated when it expires
+    connection.lastReceive = connection.lastSend = std::chrono::steady_clock::now();
+    _updateTimeout(shard, connection);
+
+    shard.runLoop.add(s, POLLIN | POLLOUT | POLLHUP);
+    return true;
+}
+
+TCPService::Shard::ReceiveBuffer& TCPService::_receiveBuffer(Shard& shard) {
+    auto& buffers = shard.receiveBuffers;
+
+    // usually the current buffer is free, unless a delegate retained it
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        auto index = (shard.receiveBufferIndex + i) % buffers.size();
+        if (buffers[index].owner.use_count() == 1) {
+            // synchronizes with whichever thread released it last
+            std::atomic_thread_fence(std::memory_order_acquire);
+            shard.receiveBufferIndex = index;
+            return buffers[index];
+        }
+    }
+
+    std::shared_ptr<char> data{new char[kReceiveBufferSize], std::default_delete<char[]>()};
+    Shard::ReceiveBuffer buffer;
+    buffer.data = data.get();
+    buffer.owner = std::move(data);
+
+    if (buffers.size() < kMaxReceiveBuffers) {
+        buffers.emplace_back(std::move(buffer));
+        shard.receiveBufferIndex = buffers.size() - 1;
+    } else {
+        // every buffer is retained. the pool gives up its reference to this one, which is freed
+        // when the delegate releases it
+        buffers[shard.receiveBufferIndex] = std::move(buffer);
+    }
+
+    return buffers[shard.receiveBufferIndex];
+}
+
+bool TCPService::_receive(Shard& shard, Connection& connection) {
+    Increment(shard.receiveWakeups);
+
+    const size_t budget = _receiveBudget;
+    size_t received = 0;
+
+    while (received < budget) {
+        auto& buffer = _receiveBuffer(shard);
+        auto bytes = recv(connection.fd, buffer.data, std::min(kReceiveBufferSize, budget - received), 0);
+        Increment(shard.receiveCalls);
+
+        if (bytes < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+            return true;
+        }
+
+        if (bytes <= 0) {
+            if (bytes < 0) {
+                SCRAPS_LOG_ERROR("socket error (fd = {}, errno = {})", connection.fd, static_cast<int>(errno));
+            } else {
+                SCRAPS_LOG_INFO("closing connection (fd = {})", connection.fd);
+            }
+
+            _closeAndErase(shard, connection);
+            return false;
+        }
+
+        Increment(shard.bytesReceived, bytes);
+        received += bytes;
+
+        // once per wakeup is precise enough for idle timeouts
+        if (connection.timeoutId != TimerWheel<ConnectionId>::kInvalidId && received == static_cast<size_t>(bytes)) {
+            connection.lastReceive = std::chrono::steady_clock::now();
+        }
+
+        _delegate->tcpServiceConnectionReceivedBuffer(connection.id, buffer.owner, buffer.data, static_cast<size_t>(bytes));
+    }
+
+    // the poller is level-triggered, so we'll be woken up again for the rest
+    Increment(shard.receiveBudgetExhausted);
+    return true;
+}
+
+void TCPService::_send(Shard& shard, ConnectionId connectionId, const Connection::SendBuffer& buffer) {
+    auto connection = shard.connections.findById(connectionId);
+    if (!connection || connection->isClosing()) {
+        _releaseQueuedBytes(buffer.length);
         return;
     }
 
-    _connections.emplace(connectionId, s, Connection::kConnecting);
+    connection->sendQueue.push_back(buffer);
+
+    if (!connection->queuedBytes && buffer.length && _idleWriteTimeout.load().count()) {
+        // the write timeout starts once there's something to write
+        connection->lastSend = std::chrono::steady_clock::now();
+        connection->queuedBytes += buffer.length;
+        _updateTimeout(shard, *connection);
+    } else {
+        connection->queuedBytes += buffer.length;
+    }
+
+    if (!connection->isBackpressured && connection->queuedBytes >= _sendQueueHighWaterMark) {
+        connection->isBackpressured = true;
+        _delegate->tcpServiceConnectionBackpressure(connectionId);
+    }
 
-    _runLoop.add(s, POLLIN | POLLOUT | POLLHUP);
+    _trySend(shard, *connection);
 }
 
-void TCPService::_trySend(Connection& connection) {
-    if (!connection.isConnected()) { return; }
+bool TCPService::_trySend(Shard& shard, Connection& connection) {
+    if (!connection.isConnected()) { return true; }
 
-    while (!connection.sendQueue.empty()) {
-        auto& buffer = connection.sendQueue.front();
+    auto& queue = connection.sendQueue;
 
-        auto remaining = buffer->data.size() - buffer->sent;
+    while (connection.sendQueueHead < queue.size()) {
+        // coalesce as much of the queue as we can into a single call
+        shard.iovecs.clear();
+        size_t length = 0;
+        for (auto it = queue.begin() + connection.sendQueueHead; it != queue.end(); ++it) {
+            auto& buffer = *it;
+            if (shard.iovecs.size() >= kMaxSendBuffers || length >= kMaxSendBytes) { break; }
 
-        if (!remaining) {
-            connection.sendQueue.pop();
-            continue;
+            auto remaining = buffer.length - buffer.sent;
+            if (!remaining) { continue; }
+
+            iovec iov;
+            iov.iov_base = const_cast<char*>(buffer.data + buffer.sent);
+            iov.iov_len = remaining;
+            shard.iovecs.push_back(iov);
+            length += remaining;
+        }
+
+        if (shard.iovecs.empty()) {
+            connection.sendQueueHead = queue.size();
+            break;
         }
 
-        auto sent = ::send(connection.fd, static_cast<const char*>(buffer->data.data()) + buffer->sent, remaining, 0);
+        msghdr message{};
+        message.msg_iov = shard.iovecs.data();
+        message.msg_iovlen = shard.iovecs.size();
+
+        auto sent = ::sendmsg(connection.fd, &message, 0);
 
         if (sent < 0) {
             if (errno == EWOULDBLOCK || errno == EAGAIN) {
                 break;
             } else {
                 SCRAPS_LOG_ERROR("socket send error (errno = {})", static_cast<int>(errno));
-                _closeAndErase(connection);
-                return;
+                _closeAndErase(shard, connection);
+                return false;
             }
         }
 
-        if (static_cast<size_t>(sent) < remaining) {
-            buffer->sent += sent;
+        Increment(shard.sendCalls);
+        Increment(shard.sendBuffers, shard.iovecs.size());
+        Increment(shard.bytesSent, sent);
+        connection.queuedBytes -= sent;
+        _releaseQueuedBytes(sent);
+
+        if (connection.timeoutId != TimerWheel<ConnectionId>::kInvalidId && sent > 0) {
+            connection.lastSend = std::chrono::steady_clock::now();
+        }
+
+        auto unconsumed = static_cast<size_t>(sent);
+        while (connection.sendQueueHead < queue.size()) {
+            auto& buffer = queue[connection.sendQueueHead];
+            auto remaining = buffer.length - buffer.sent;
+            if (remaining > unconsumed) {
+                buffer.sent += unconsumed;
+                break;
+            }
+            unconsumed -= remaining;
+            buffer = Connection::SendBuffer{};
+            ++connection.sendQueueHead;
+        }
+
+        if (static_cast<size_t>(sent) < length) {
+            // the socket's buffer is full
             break;
         }
+    }
 
-        connection.sendQueue.pop();
+    if (connection.sendQueueHead == queue.size()) {
+        connection.sendQueueHead = 0;
+        queue.clear();
+        if (queue.capacity() > kMaxRetainedSendQueueCapacity) {
+            queue.shrink_to_fit();
+        }
+    } else if (connection.sendQueueHead * 2 >= queue.size()) {
+        // the sent buffers are at least half of the queue, so shifting the rest is amortized
+        queue.erase(queue.begin(), queue.begin() + connection.sendQueueHead);
+        connection.sendQueueHead = 0;
     }
 
-    _runLoop.add(connection.fd, POLLIN | (connection.sendQueue.empty() ? 0 : POLLOUT) | POLLHUP);
+    shard.runLoop.add(connection.fd, POLLIN | (queue.empty() ? 0 : POLLOUT) | POLLHUP);
+
+    if (connection.isBackpressured && connection.queuedBytes <= _sendQueueLowWaterMark) {
+        connection.isBackpressured = false;
+        _delegate->tcpServiceConnectionWritable(connection.id);
+    }
+
+    return true;
 }
 
-void TCPService::_closeAndErase(Connection& connection) {
+void TCPService::_closeAndErase(Shard& shard, Connection& connection) {
     auto id = connection.id;
     auto wasConnecting = connection.isConnecting();
 
-    _runLoop.remove(connection.fd);
-    _connections.erase(connection.id);
+    _releaseQueuedBytes(connection.queuedBytes);
+    connection.queuedBytes = 0;
+
+    if (connection.timeoutId != TimerWheel<ConnectionId>::kInvalidId) {
+        shard.timeouts.erase(connection.timeoutId);
+    }
+    --_openConnections;
+
+    shard.runLoop.remove(connection.fd);
+    shard.connections.erase(connection);
 
     if (wasConnecting) {
         _delegate->tcpServiceConnectionFailed(id);
@@ -381,4 +1028,148 @@ void TCPService::_closeAndErase(Connection& connection) {
     }
 }
 
+void TCPService::_closeAll(Shard& shard) {
+    shard.connections.forEach([&](Connection& connection) {
+        _closeAndErase(shard, connection);
+    });
+
+    shard.timeouts.clear();
+    shard.timeoutTimer.cancel();
+    shard.timeoutTimerDeadline = stdts::nullopt;
+
+    if (shard.listenFD >= 0) {
+        shard.runLoop.remove(shard.listenFD);
+        ::close(shard.listenFD);
+        shard.listenFD = -1;
+    }
+}
+
+void TCPService::_configureSocket(int fd) {
+    int one = 1;
+    if (_noDelay && setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0) {
+        SCRAPS_LOG_WARNING("unable to set TCP_NODELAY on socket (errno = {})", static_cast<int>(errno));
+    }
+
+    if (!_keepAlive) { return; }
+
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one)) < 0) {
+        SCRAPS_LOG_WARNING("unable to set SO_KEEPALIVE on socket (errno = {})", static_cast<int>(errno));
+        return;
+    }
+
+    if (int idle = static_cast<int>(_keepAliveIdle.load().count())) {
+#if defined(TCP_KEEPIDLE)
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+#elif defined(TCP_KEEPALIVE)
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPALIVE, &idle, sizeof(idle));
+#endif
+    }
+
+#if defined(TCP_KEEPINTVL)
+    if (int interval = static_cast<int>(_keepAliveInterval.load().count())) {
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    }
+#endif
+
+#if defined(TCP_KEEPCNT)
+    if (int probes = _keepAliveProbes) {
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+    }
+#endif
+}
+
+stdts::optional<std::chrono::steady_clock::time_point> TCPService::_timeoutDeadline(const Connection& connection) {
+    stdts::optional<std::chrono::steady_clock::time_point> deadline;
+    auto consider = [&](std::chrono::steady_clock::time_point candidate) {
+        if (!deadline || candidate < *deadline) {
+            deadline = candidate;
+        }
+    };
+
+    if (connection.isConnecting()) {
+        if (auto timeout = _connectTimeout.load(); timeout.count()) {
+            consider(connection.lastSend + timeout);
+        }
+        return deadline;
+    }
+
+    if (auto timeout = _idleReadTimeout.load(); timeout.count()) {
+        consider(connection.lastReceive + timeout);
+    }
+    if (auto timeout = _idleWriteTimeout.load(); timeout.count() && connection.queuedBytes) {
+        consider(connection.lastSend + timeout);
+    }
+    return deadline;
+}
+
+void TCPService::_updateTimeout(Shard& shard, Connection& connection) {
+    auto deadline = _timeoutDeadline(connection);
+    if (!deadline) {
+        // an existing entry is left alone. it's reevaluated when it expires
+        return;
+    }
+
+    if (connection.timeoutId == TimerWheel<ConnectionId>::kInvalidId) {
+        connection.timeoutId = shard.timeouts.insert(*deadline, connection.id);
+    } else if (*deadline < connection.timeoutDeadline) {
+        shard.timeouts.reschedule(connection.timeoutId, *deadline);
+    } else {
+        // activity only pushes deadlines back, so entries are allowed to expire early and are
+        // reevaluated then. this keeps the hot paths down to a timestamp update
+        return;
+    }
+
+    connection.timeoutDeadline = *deadline;
+    _armTimeouts(shard);
+}
+
+void TCPService::_armTimeouts(Shard& shard) {
+    auto next = shard.timeouts.nextExpiration();
+    if (!next || (shard.timeoutTimerDeadline && *shard.timeoutTimerDeadline <= *next)) {
+        return;
+    }
+
+    shard.timeoutTimerDeadline = *next;
+    auto delay = std::max(*next - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero());
+    if (!shard.timeoutTimer.reschedule(delay)) {
+        shard.timeoutTimer = shard.runLoop.async([this, &shard] {
+            shard.timeoutTimerDeadline = stdts::nullopt;
+            _expireTimeouts(shard);
+        }, delay);
+    }
+}
+
+void TCPService::_expireTimeouts(Shard& shard) {
+    const auto now = std::chrono::steady_clock::now();
+    shard.timeouts.expire(now, &shard.expiredTimeouts);
+
+    for (auto connectionId : shard.expiredTimeouts) {
+        auto connection = shard.connections.findById(connectionId);
+        if (!connection) { continue; }
+
+        connection->timeoutId = TimerWheel<ConnectionId>::kInvalidId;
+
+        auto deadline = _timeoutDeadline(*connection);
+        if (!deadline) { continue; }
+
+        if (*deadline > now) {
+            connection->timeoutId = shard.timeouts.insert(*deadline, connectionId);
+            connection->timeoutDeadline = *deadline;
+            continue;
+        }
+
+        if (connection->isConnecting() && _connectNextCandidate(shard, *connection)) {
+            continue;
+        }
+
+        SCRAPS_LOG_INFO("connection timed out (fd = {})", connection->fd);
+        Increment(shard.connectionsTimedOut);
+        _delegate->tcpServiceConnectionTimedOut(connectionId);
+        _closeAndErase(shard, *connection);
+    }
+
+    shard.expiredTimeouts.clear();
+    _armTimeouts(shard);
+}
+
 } // namespace scraps::net
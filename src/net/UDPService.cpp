@@ -17,31 +17,24 @@
 
 #include <scraps/logging.h>
 
-namespace scraps::net {
-
-UDPService::UDPService() {
-    _runLoop.setEventHandler([this](int fd, short events) {
-        std::lock_guard<std::mutex> lock(_mutex);
-
-        auto it = _sockets.find(fd);
-        if (it == _sockets.end()) { return; }
+#include <limits>
 
-        auto socket = it->second.lock();
-        if (!socket) {
-            _sockets.erase(it);
-            _runLoop.remove(fd);
-            return;
-        }
+namespace scraps::net {
 
-        if (events & POLLIN) {
-            socket->receive();
-        }
-    });
+UDPService::UDPService(RunLoopGroup* group)
+    : _ownedGroup{group ? nullptr : std::make_unique<RunLoopGroup>(1, "UDPService")}
+    , _group{group ? group : _ownedGroup.get()}
+{
+    for (size_t i = 0; i < _group->size(); ++i) {
+        _shards.emplace_back(std::make_unique<Shard>());
+        _group->loop(i).setEventHandler([this, i](int fd, short events) {
+            _eventHandler(i, fd, events);
+        });
+    }
 
     SCRAPS_LOGF_INFO("starting udp service thread");
-    _thread = std::thread([this] {
-        _runLoop.run();
-    });
+    _group->start();
+    _isRunning = true;
 }
 
 UDPService::~UDPService() {
@@ -49,18 +42,15 @@ UDPService::~UDPService() {
 }
 
 void UDPService::kill() {
-    if (_thread.joinable()) {
+    if (_isRunning) {
         SCRAPS_LOGF_INFO("stopping udp service thread");
-        _runLoop.cancel();
-        _runLoop.flush();
-        _thread.join();
+        _group->stop();
+        _group->wait();
+        _isRunning = false;
     }
 }
 
 std::shared_ptr<UDPSocket> UDPService::openSocket(UDPSocket::Protocol protocol, uint16_t port, std::weak_ptr<UDPReceiver> receiver, const char* interface) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    _purgeDeadSockets();
-
     auto socket = std::make_shared<UDPSocket>(protocol, receiver);
     if (interface) {
         if (!socket->bind(interface, port)) {
@@ -70,37 +60,131 @@ std::shared_ptr<UDPSocket> UDPService::openSocket(UDPSocket::Protocol protocol,
         return nullptr;
     }
 
-    auto fd = socket->native();
-    _sockets[fd] = socket;
-    _runLoop.add(fd, POLLIN);
+    _addSocket(socket);
     return socket;
 }
 
-std::shared_ptr<UDPSocket> UDPService::openMulticastSocket(const Address& groupAddress, uint16_t port, std::weak_ptr<UDPReceiver> receiver) {
-    std::lock_guard<std::mutex> lock(_mutex);
+std::vector<std::shared_ptr<UDPSocket>> UDPService::openSocketGroup(UDPSocket::Protocol protocol, uint16_t port, std::weak_ptr<UDPReceiver> receiver, const char* interface) {
+    std::vector<std::shared_ptr<UDPSocket>> sockets;
+    for (size_t i = 0; i < _group->size(); ++i) {
+        auto socket = std::make_shared<UDPSocket>(protocol, receiver);
+        if (!socket->setReusePort() || !socket->bind(interface, port)) {
+            return {};
+        }
+        if (!port) {
+            port = socket->port();
+        }
+        sockets.emplace_back(std::move(socket));
+    }
+
+    // pin each socket to its own loop rather than sharding by descriptor
     _purgeDeadSockets();
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        _addSocket(sockets[i], i);
+    }
+    return sockets;
+}
 
+std::shared_ptr<UDPSocket> UDPService::openMulticastSocket(const Address& groupAddress, uint16_t port, std::weak_ptr<UDPReceiver> receiver) {
     auto protocol = groupAddress.is_v4() ? UDPSocket::Protocol::kIPv4 : UDPSocket::Protocol::kIPv6;
     auto socket = std::make_shared<UDPSocket>(protocol, receiver);
     if (!socket->bindMulticast(groupAddress.to_string().c_str(), port)) {
         return nullptr;
     }
 
-    auto fd = socket->native();
-    _sockets[fd] = socket;
-    _runLoop.add(fd, POLLIN);
+    _addSocket(socket);
     return socket;
 }
 
+void UDPService::_eventHandler(size_t index, int fd, short events) {
+    auto& shard = *_shards[index];
+
+    auto version = shard.version.load(std::memory_order_acquire);
+    if (version != shard.loopVersion) {
+        shard.loopSockets = std::atomic_load(&shard.sockets);
+        shard.loopVersion = version;
+    }
+
+    auto it = shard.loopSockets->find(fd);
+    if (it == shard.loopSockets->end()) { return; }
+
+    auto socket = it->second.lock();
+    if (!socket) {
+        _removeSocket(index, fd);
+        return;
+    }
+
+    if (events & POLLIN) {
+        socket->receive();
+    }
+}
+
+void UDPService::_addSocket(const std::shared_ptr<UDPSocket>& socket) {
+    _purgeDeadSockets();
+    _addSocket(socket, _leastLoadedShard());
+}
+
+void UDPService::_addSocket(const std::shared_ptr<UDPSocket>& socket, size_t index) {
+    auto fd = socket->native();
+    auto& shard = *_shards[index];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto sockets = std::make_shared<SocketMap>(*shard.sockets);
+    (*sockets)[fd] = socket;
+    std::atomic_store(&shard.sockets, std::shared_ptr<const SocketMap>(std::move(sockets)));
+    shard.version.fetch_add(1, std::memory_order_release);
+    _group->loop(index).add(fd, POLLIN);
+}
+
+void UDPService::_removeSocket(size_t index, int fd) {
+    auto& shard = *_shards[index];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sockets->find(fd);
+    if (it == shard.sockets->end() || !it->second.expired()) { return; }
+
+    auto sockets = std::make_shared<SocketMap>(*shard.sockets);
+    sockets->erase(fd);
+    std::atomic_store(&shard.sockets, std::shared_ptr<const SocketMap>(std::move(sockets)));
+    shard.version.fetch_add(1, std::memory_order_release);
+    _group->loop(index).remove(fd);
+}
+
 void UDPService::_purgeDeadSockets() {
-    for (auto it = _sockets.begin(); it != _sockets.end();) {
-        if (!it->second.lock()) {
-            _runLoop.remove(it->first);
-            it = _sockets.erase(it);
-        } else {
-            ++it;
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        auto& shard = *_shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        std::shared_ptr<SocketMap> sockets;
+        for (auto& kv : *shard.sockets) {
+            if (kv.second.expired()) {
+                if (!sockets) {
+                    sockets = std::make_shared<SocketMap>(*shard.sockets);
+                }
+                sockets->erase(kv.first);
+                _group->loop(i).remove(kv.first);
+            }
+        }
+
+        if (sockets) {
+            std::atomic_store(&shard.sockets, std::shared_ptr<const SocketMap>(std::move(sockets)));
+            shard.version.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+size_t UDPService::_leastLoadedShard() const {
+    size_t best = 0;
+    size_t bestCount = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        auto& shard = *_shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.sockets->size() < bestCount) {
+            best = i;
+            bestCount = shard.sockets->size();
         }
     }
+    return best;
 }
 
 } // namespace scraps::net
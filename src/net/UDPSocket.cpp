@@ -21,6 +21,12 @@
 
 #include <gsl.h>
 
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+#include <netinet/udp.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
 #include <cassert>
 
 namespace scraps::net {
@@ -31,6 +37,33 @@ constexpr size_t UDPSocket::kIPv6HeaderSize;
 constexpr size_t UDPSocket::kUDPHeaderSize;
 constexpr size_t UDPSocket::kMaxIPv4UDPPayloadSize;
 constexpr size_t UDPSocket::kMaxIPv6UDPPayloadSize;
+constexpr size_t UDPSocket::kBatchSize;
+constexpr size_t UDPSocket::kReceiveBufferSize;
+constexpr size_t UDPSocket::kMaxOffloadSegments;
+constexpr size_t UDPSocket::kMaxOffloadSize;
+constexpr size_t UDPSocket::kOffloadBatchSize;
+constexpr size_t UDPSocket::kMaxPooledReceiveBuffers;
+
+namespace {
+
+// coalesced datagrams are received into buffers of this size
+constexpr size_t kOffloadReceiveBufferSize = 65536;
+
+// enough for any control messages we send or receive. with metadata, a message can carry a
+// segment size, a timestamp, packet info, and a traffic class
+constexpr size_t kControlBufferSize = 128;
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+// converts a kernel timestamp, which is on the system clock, to the steady clock
+std::chrono::steady_clock::time_point SteadyTimestamp(const timespec& timestamp, std::chrono::steady_clock::time_point steadyNow, std::chrono::system_clock::time_point systemNow) {
+    auto time = std::chrono::system_clock::time_point{std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::seconds{timestamp.tv_sec} + std::chrono::nanoseconds{timestamp.tv_nsec})};
+    auto age = std::chrono::duration_cast<std::chrono::steady_clock::duration>(systemNow - time);
+    // the clocks can drift or be adjusted, but the datagram can't have arrived after it was read
+    return steadyNow - std::max(age, std::chrono::steady_clock::duration::zero());
+}
+#endif
+
+} // anonymous namespace
 
 UDPSocket::UDPSocket(Protocol protocol, std::weak_ptr<UDPReceiver> receiver)
     : _socket{::socket(protocol == Protocol::kIPv4 ? AF_INET : AF_INET6, SOCK_DGRAM, 0)}
@@ -51,6 +84,63 @@ void UDPSocket::setReceiver(std::weak_ptr<UDPReceiver> receiver) {
     _receiver = receiver;
 }
 
+bool UDPSocket::setReusePort() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_socket < 0) { return false; }
+
+#if SO_REUSEPORT
+    constexpr int one = 1;
+    if (setsockopt(_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))) {
+        SCRAPS_LOG_ERROR("error setting SO_REUSEPORT (errno = {})", static_cast<int>(errno));
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint16_t UDPSocket::port() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_socket < 0) { return 0; }
+
+    sockaddr_storage addr;
+    socklen_t addrLength = sizeof(addr);
+    if (getsockname(_socket, reinterpret_cast<sockaddr*>(&addr), &addrLength)) {
+        return 0;
+    }
+    return SockAddr{reinterpret_cast<sockaddr*>(&addr), addrLength}.port();
+}
+
+bool UDPSocket::setReceiveMetadata(bool enabled) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_socket < 0) { return false; }
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    int value = enabled ? 1 : 0;
+    auto success = setsockopt(_socket, SOL_SOCKET, SO_TIMESTAMPNS, &value, sizeof(value)) == 0;
+    if (_protocol == Protocol::kIPv4) {
+        success = success && setsockopt(_socket, IPPROTO_IP, IP_PKTINFO, &value, sizeof(value)) == 0;
+        success = success && setsockopt(_socket, IPPROTO_IP, IP_RECVTOS, &value, sizeof(value)) == 0;
+    } else {
+        success = success && setsockopt(_socket, IPPROTO_IPV6, IPV6_RECVPKTINFO, &value, sizeof(value)) == 0;
+        success = success && setsockopt(_socket, IPPROTO_IPV6, IPV6_RECVTCLASS, &value, sizeof(value)) == 0;
+        // ipv4-mapped datagrams on dual-stack sockets report ipv4 metadata
+        setsockopt(_socket, IPPROTO_IP, IP_PKTINFO, &value, sizeof(value));
+        setsockopt(_socket, IPPROTO_IP, IP_RECVTOS, &value, sizeof(value));
+    }
+
+    if (enabled && !success) {
+        SCRAPS_LOG_WARNING("udp receive metadata is not supported (errno = {})", static_cast<int>(errno));
+    }
+
+    _isReceiveMetadataEnabled = enabled && success;
+    return _isReceiveMetadataEnabled;
+#else
+    return false;
+#endif
+}
+
 bool UDPSocket::bind(uint16_t port) {
     return bind(nullptr, port);
 }
@@ -109,22 +199,28 @@ bool UDPSocket::bindMulticast(const char* groupAddress, uint16_t port) {
 }
 
 bool UDPSocket::send(const Endpoint& destination, const void* data, size_t length) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    if (_socket < 0) { return false; }
+    return send(SockAddr{destination}, data, length);
+}
 
-    sockaddr_storage addr;
-    socklen_t addrLength;
-    destination.getSockAddr(&addr, &addrLength);
-    int sent = ::sendto(_socket, data, length, 0, reinterpret_cast<sockaddr*>(&addr), addrLength);
+bool UDPSocket::send(const SockAddr& destination, const void* data, size_t length) {
+    return send(destination.native(), destination.length(), data, length);
+}
+
+bool UDPSocket::send(const sockaddr* destination, socklen_t destinationLength, const void* data, size_t length) {
+    auto socket = _beginSend();
+    if (socket < 0) { return false; }
+    auto _ = gsl::finally([&] { _endSend(); });
+
+    auto sent = ::sendto(socket, data, length, 0, destination, destinationLength);
 
     if (sent < 0) {
         SCRAPS_LOG_ERROR("udp socket send error (errno = {})", static_cast<int>(errno));
+        return false;
     } else if (static_cast<size_t>(sent) != length) {
         SCRAPS_LOG_WARNING("udp socket sent != length ({} != {})", sent, length);
     }
 
-    if ((destination.address().is_v4() && static_cast<size_t>(sent) > kMaxIPv4UDPPayloadSize) ||
-        (destination.address().is_v6() && static_cast<size_t>(sent) > kMaxIPv6UDPPayloadSize)) {
+    if (static_cast<size_t>(sent) > (destination->sa_family == AF_INET ? kMaxIPv4UDPPayloadSize : kMaxIPv6UDPPayloadSize)) {
         SCRAPS_LOG_WARNING("udp socket sent {} bytes, which is over the max udp payload size", sent);
     }
 
@@ -133,59 +229,381 @@ bool UDPSocket::send(const Endpoint& destination, const void* data, size_t lengt
     return static_cast<size_t>(sent) == length;
 }
 
+size_t UDPSocket::sendBatch(const Datagram* datagrams, size_t count) {
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    auto socket = _beginSend();
+    if (socket < 0) { return 0; }
+    auto _ = gsl::finally([&] { _endSend(); });
+    return _sendBatch(socket, datagrams, count, _isSendOffloadEnabled);
+#else
+    return UDPSender::sendBatch(datagrams, count);
+#endif
+}
+
+bool UDPSocket::setSegmentationOffload(bool enabled) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_socket < 0) { return false; }
+
+#if (SCRAPS_LINUX || SCRAPS_ANDROID) && defined(UDP_SEGMENT) && defined(UDP_GRO)
+    if (!enabled) {
+        if (_isReceiveOffloadEnabled) {
+            int zero = 0;
+            setsockopt(_socket, IPPROTO_UDP, UDP_GRO, &zero, sizeof(zero));
+        }
+        _isSendOffloadEnabled = _isReceiveOffloadEnabled = false;
+        return false;
+    }
+
+    // segmentation is requested per message, so probing the option is enough to know whether
+    // it's supported
+    int segmentSize = 0;
+    socklen_t segmentSizeLength = sizeof(segmentSize);
+    _isSendOffloadEnabled = getsockopt(_socket, IPPROTO_UDP, UDP_SEGMENT, &segmentSize, &segmentSizeLength) == 0;
+
+    int one = 1;
+    _isReceiveOffloadEnabled = setsockopt(_socket, IPPROTO_UDP, UDP_GRO, &one, sizeof(one)) == 0;
+
+    if (!_isSendOffloadEnabled || !_isReceiveOffloadEnabled) {
+        SCRAPS_LOG_INFO("udp segmentation offload is only partially supported (send = {}, receive = {})", _isSendOffloadEnabled.load(), _isReceiveOffloadEnabled.load());
+    }
+
+    return _isSendOffloadEnabled || _isReceiveOffloadEnabled;
+#else
+    return false;
+#endif
+}
+
 void UDPSocket::receive() {
+    // everything but the buffer pool is local, so that several threads can receive at once
+    std::array<Message, kBatchSize> messages;
+    std::array<UDPReceiver::Datagram, kMaxOffloadSegments> datagrams;
+
     while (true) {
         std::unique_lock<std::mutex> lock(_mutex);
         if (_socket < 0) { return; }
 
-        sockaddr_storage senderStorage;
-        socklen_t senderStorageLength = sizeof(senderStorage);
+        size_t batchSize = 0;
+        auto count = _receiveBatch(messages.data(), &batchSize);
+        if (!count) {
+            return;
+        }
 
-        auto bytes = ::recvfrom(_socket, &_buffer, sizeof(_buffer), 0, reinterpret_cast<sockaddr*>(&senderStorage), &senderStorageLength);
+        auto receiver = _receiver.lock();
+        lock.unlock();
+
+        if (receiver) {
+            size_t pending = 0;
+            for (size_t i = 0; i < count; ++i) {
+                auto& message = messages[i];
+                SockAddr sender{reinterpret_cast<sockaddr*>(&message.sender), message.senderLength};
+                auto data = message.buffer.get();
+
+                // split up datagrams that were coalesced by the kernel
+                auto segmentSize = message.segmentSize ? message.segmentSize : message.length;
+                size_t offset = 0;
+                do {
+                    if (pending == datagrams.size()) {
+                        receiver->receiveUDPBatch(datagrams.data(), pending);
+                        pending = 0;
+                    }
+                    auto length = std::min(segmentSize, message.length - offset);
+                    auto& datagram = datagrams[pending++];
+                    datagram.sender = sender;
+                    datagram.buffer = message.buffer;
+                    datagram.data = data + offset;
+                    datagram.length = length;
+                    datagram.timestamp = message.timestamp;
+                    datagram.destination = message.destination;
+                    datagram.ecn = message.ecn;
+                    offset += length;
+                } while (offset < message.length);
+            }
+            receiver->receiveUDPBatch(datagrams.data(), pending);
+        }
 
-        if (bytes < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
-            break;
+        // give the buffers back to the pool unless the receiver kept them
+        for (auto& datagram : datagrams) {
+            datagram.buffer.reset();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            messages[i].buffer.reset();
         }
 
-        if (bytes <= 0) {
-            if (bytes < 0) {
-                SCRAPS_LOG_ERROR("udp socket error (errno = {})", static_cast<int>(errno));
-            }
+        if (count < batchSize) {
+            // the socket is probably drained. if not, the poller will let us know
             return;
         }
+    }
+}
 
-        _totalReceivedBytes += bytes;
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+size_t UDPSocket::_sendBatch(int socket, const Datagram* datagrams, size_t count, bool offload) {
+    std::array<mmsghdr, kBatchSize> messages;
+    // the number of datagrams in each message
+    std::array<size_t, kBatchSize> segments;
+    std::array<iovec, 16 * kMaxOffloadSegments> iovecs;
+    alignas(cmsghdr) unsigned char control[kBatchSize][kControlBufferSize];
+
+    size_t sent = 0;
+    size_t i = 0;
+    while (i < count) {
+        size_t messageCount = 0;
+        size_t iovecCount = 0;
+        for (auto next = i; next < count && messageCount < kBatchSize && iovecCount + kMaxOffloadSegments <= iovecs.size(); ++messageCount) {
+            auto& first = datagrams[next];
+
+            // runs of datagrams with the same destination and length can be sent as one. only
+            // the last may be shorter
+            size_t n = 1;
+            auto maxSegmentSize = first.destination.isV4() ? kMaxIPv4UDPPayloadSize : kMaxIPv6UDPPayloadSize;
+            if (offload && first.length && first.length <= maxSegmentSize) {
+                auto total = first.length;
+                while (next + n < count && n < kMaxOffloadSegments) {
+                    auto& datagram = datagrams[next + n];
+                    if (!datagram.length || datagram.length > first.length || total + datagram.length > kMaxOffloadSize || datagram.destination != first.destination) {
+                        break;
+                    }
+                    total += datagram.length;
+                    ++n;
+                    if (datagram.length < first.length) { break; }
+                }
+            }
+
+            auto& message = messages[messageCount];
+            message = {};
+            message.msg_hdr.msg_name = const_cast<sockaddr*>(first.destination.native());
+            message.msg_hdr.msg_namelen = first.destination.length();
+            message.msg_hdr.msg_iov = &iovecs[iovecCount];
+            message.msg_hdr.msg_iovlen = n;
+
+            for (size_t j = 0; j < n; ++j) {
+                iovecs[iovecCount].iov_base = const_cast<void*>(datagrams[next + j].data);
+                iovecs[iovecCount].iov_len = datagrams[next + j].length;
+                ++iovecCount;
+            }
+
+#if defined(UDP_SEGMENT)
+            if (n > 1) {
+                message.msg_hdr.msg_control = control[messageCount];
+                message.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                auto cmsg = CMSG_FIRSTHDR(&message.msg_hdr);
+                cmsg->cmsg_level = IPPROTO_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                auto segmentSize = static_cast<uint16_t>(first.length);
+                memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+            }
+#endif
+
+            segments[messageCount] = n;
+            next += n;
+        }
+
+        auto result = ::sendmmsg(socket, messages.data(), static_cast<unsigned int>(messageCount), 0);
+        if (result < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                break;
+            }
+            if (segments[0] > 1 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)) {
+                // the kernel or device can't segment after all
+                SCRAPS_LOG_WARNING("disabling udp send offload (errno = {})", static_cast<int>(errno));
+                _isSendOffloadEnabled = false;
+                offload = false;
+                continue;
+            }
+            // the first message couldn't be sent. skip it like send would
+            SCRAPS_LOG_ERROR("udp socket send error (errno = {})", static_cast<int>(errno));
+            i += segments[0];
+            continue;
+        }
+
+        for (int j = 0; j < result; ++j) {
+            _totalSentBytes += messages[j].msg_len;
+            sent += segments[j];
+            i += segments[j];
+        }
+    }
+
+    return sent;
+}
+#endif
+
+std::shared_ptr<unsigned char> UDPSocket::_receiveBuffer(size_t size) {
+    if (_receiveBufferSize != size) {
+        _receiveBuffers.clear();
+        _receiveBufferIndex = 0;
+        _receiveBufferSize = size;
+    }
+
+    for (size_t i = 0; i < _receiveBuffers.size(); ++i) {
+        auto& buffer = _receiveBuffers[(_receiveBufferIndex + i) % _receiveBuffers.size()];
+        if (buffer.use_count() == 1) {
+            // synchronize with the release of the receiver's last reference
+            std::atomic_thread_fence(std::memory_order_acquire);
+            _receiveBufferIndex = (_receiveBufferIndex + i + 1) % _receiveBuffers.size();
+            return buffer;
+        }
+    }
+
+    std::shared_ptr<unsigned char> buffer{new unsigned char[size], std::default_delete<unsigned char[]>()};
+    if (_receiveBuffers.size() < kMaxPooledReceiveBuffers) {
+        _receiveBuffers.emplace_back(buffer);
+    }
+    return buffer;
+}
+
+size_t UDPSocket::_receiveBatch(Message* messages, size_t* batchSize) {
+    const bool offload = _isReceiveOffloadEnabled;
+    const bool metadata = _isReceiveMetadataEnabled;
+    const auto bufferSize = offload ? kOffloadReceiveBufferSize : kReceiveBufferSize;
+    *batchSize = offload ? kOffloadBatchSize : kBatchSize;
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    std::array<iovec, kBatchSize> iovecs;
+    std::array<mmsghdr, kBatchSize> headers;
+    alignas(cmsghdr) unsigned char control[kBatchSize][kControlBufferSize];
+    for (size_t i = 0; i < *batchSize; ++i) {
+        auto& message = messages[i];
+        message.buffer = _receiveBuffer(bufferSize);
+        iovecs[i].iov_base = message.buffer.get();
+        iovecs[i].iov_len = bufferSize;
+        headers[i] = {};
+        headers[i].msg_hdr.msg_name = &message.sender;
+        headers[i].msg_hdr.msg_namelen = sizeof(message.sender);
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        if (offload || metadata) {
+            headers[i].msg_hdr.msg_control = control[i];
+            headers[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+    }
 
-        auto sender = Endpoint::FromSockaddr(
-            reinterpret_cast<sockaddr*>(&senderStorage),
-            senderStorageLength
-        );
+    auto result = ::recvmmsg(_socket, headers.data(), static_cast<unsigned int>(*batchSize), 0, nullptr);
+    const auto count = result < 0 ? 0 : static_cast<size_t>(result);
+
+    // release the buffers that weren't needed
+    for (size_t i = count; i < *batchSize; ++i) {
+        messages[i].buffer.reset();
+    }
+
+    if (result < 0) {
+        if (errno != EWOULDBLOCK && errno != EAGAIN) {
+            SCRAPS_LOG_ERROR("udp socket error (errno = {})", static_cast<int>(errno));
+        }
+        return 0;
+    }
+
+    const auto steadyNow = std::chrono::steady_clock::now();
+    const auto systemNow = metadata ? std::chrono::system_clock::now() : std::chrono::system_clock::time_point{};
+
+    for (size_t i = 0; i < count; ++i) {
+        auto& message = messages[i];
+        message.length = std::min<size_t>(headers[i].msg_len, bufferSize);
+        message.senderLength = headers[i].msg_hdr.msg_namelen;
+        message.segmentSize = 0;
+        message.timestamp = steadyNow;
+        message.destination = Address{};
+        message.ecn = 0;
+        _totalReceivedBytes += message.length;
+
+        for (auto cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr); (offload || metadata) && cmsg; cmsg = CMSG_NXTHDR(&headers[i].msg_hdr, cmsg)) {
+#if defined(UDP_GRO)
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int segmentSize;
+                memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+                message.segmentSize = static_cast<size_t>(segmentSize);
+            }
+#endif
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec timestamp;
+                memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+                message.timestamp = SteadyTimestamp(timestamp, steadyNow, systemNow);
+            } else if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+                in_pktinfo info;
+                memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+                asio::ip::address_v4::bytes_type bytes;
+                memcpy(&bytes, &info.ipi_addr, sizeof(bytes));
+                message.destination = asio::ip::address_v4(bytes);
+            } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+                in6_pktinfo info;
+                memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+                asio::ip::address_v6::bytes_type bytes;
+                memcpy(&bytes, &info.ipi6_addr, sizeof(bytes));
+                message.destination = asio::ip::address_v6(bytes);
+            } else if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_TOS) {
+                unsigned char tos;
+                memcpy(&tos, CMSG_DATA(cmsg), sizeof(tos));
+                message.ecn = tos & 0x3;
+            } else if (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS) {
+                int trafficClass;
+                memcpy(&trafficClass, CMSG_DATA(cmsg), sizeof(trafficClass));
+                message.ecn = static_cast<uint8_t>(trafficClass & 0x3);
+            }
+        }
+    }
 
-        if (auto receiver = _receiver.lock()) {
-            lock.unlock();
-            receiver->receiveUDP(sender, &_buffer, static_cast<size_t>(bytes));
+    return count;
+#else
+    size_t count = 0;
+    for (; count < *batchSize; ++count) {
+        auto& message = messages[count];
+        message.buffer = _receiveBuffer(bufferSize);
+        message.senderLength = sizeof(message.sender);
+        message.segmentSize = 0;
+        auto bytes = ::recvfrom(_socket, message.buffer.get(), bufferSize, 0, reinterpret_cast<sockaddr*>(&message.sender), &message.senderLength);
+        if (bytes < 0) {
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                SCRAPS_LOG_ERROR("udp socket error (errno = {})", static_cast<int>(errno));
+            }
+            message.buffer.reset();
+            break;
         }
+        message.length = static_cast<size_t>(bytes);
+        message.timestamp = std::chrono::steady_clock::now();
+        _totalReceivedBytes += bytes;
     }
+    return count;
+#endif
 }
 
 void UDPSocket::close() {
     std::lock_guard<std::mutex> lock(_mutex);
-    if (_socket < 0) { return; }
+    auto socket = _socket.exchange(-1);
+    if (socket < 0) { return; }
+
+    // senders that loaded the socket before it was cleared are still using it
+    while (_activeSenders.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
 
 #if _WIN32
-    ::shutdown(_socket, SD_BOTH);
-    ::closesocket(_socket);
+    ::shutdown(socket, SD_BOTH);
+    ::closesocket(socket);
 #else
-    ::shutdown(_socket, SHUT_RDWR);
-    ::close(_socket);
+    ::shutdown(socket, SHUT_RDWR);
+    ::close(socket);
 #endif
 
-    _socket = -1;
     _receiver.reset();
     _totalReceivedBytes = 0;
     _totalSentBytes = 0;
 }
 
+int UDPSocket::_beginSend() {
+    // announcing the sender before loading the socket means that either close sees the sender
+    // and waits for it, or the sender sees that the socket was closed
+    _activeSenders.fetch_add(1);
+    auto socket = _socket.load();
+    if (socket < 0) {
+        _endSend();
+    }
+    return socket;
+}
+
+void UDPSocket::_endSend() {
+    _activeSenders.fetch_sub(1, std::memory_order_release);
+}
+
 bool UDPSocket::_bind(const char* interface, uint16_t port) {
     addrinfo hints;
     memset(&hints, 0, sizeof(hints));
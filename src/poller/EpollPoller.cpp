@@ -0,0 +1,139 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/poller/EpollPoller.h>
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef __NR_epoll_pwait2
+#include <linux/time_types.h>
+#endif
+
+#include <cerrno>
+
+namespace scraps::poller {
+
+constexpr size_t EpollPoller::kInitialBufferSize;
+
+namespace {
+
+uint32_t ToEpollEvents(short events) {
+    uint32_t ret = 0;
+    if (events & POLLIN)  { ret |= EPOLLIN; }
+    if (events & POLLPRI) { ret |= EPOLLPRI; }
+    if (events & POLLOUT) { ret |= EPOLLOUT; }
+#ifdef POLLRDHUP
+    if (events & POLLRDHUP) { ret |= EPOLLRDHUP; }
+#endif
+    return ret;
+}
+
+short FromEpollEvents(uint32_t events) {
+    short ret = 0;
+    if (events & EPOLLIN)  { ret |= POLLIN; }
+    if (events & EPOLLPRI) { ret |= POLLPRI; }
+    if (events & EPOLLOUT) { ret |= POLLOUT; }
+    if (events & EPOLLERR) { ret |= POLLERR; }
+    if (events & EPOLLHUP) { ret |= POLLHUP; }
+#ifdef POLLRDHUP
+    if (events & EPOLLRDHUP) { ret |= POLLRDHUP; }
+#endif
+    return ret;
+}
+
+} // anonymous namespace
+
+std::unique_ptr<EpollPoller> EpollPoller::Create() {
+    auto fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) {
+        SCRAPS_LOG_ERROR("error creating epoll instance (errno = {})", static_cast<int>(errno));
+        return nullptr;
+    }
+    return std::unique_ptr<EpollPoller>(new EpollPoller(fd));
+}
+
+EpollPoller::~EpollPoller() {
+    ::close(_epollFD);
+}
+
+bool EpollPoller::set(int fd, short events) {
+    epoll_event event{};
+    event.events = ToEpollEvents(events);
+    event.data.fd = fd;
+
+    // the caller may have closed and reopened the descriptor without removing it, in which case
+    // the kernel will already have dropped it from the interest list
+    if (epoll_ctl(_epollFD, EPOLL_CTL_MOD, fd, &event) == 0) {
+        return true;
+    } else if (errno == ENOENT && epoll_ctl(_epollFD, EPOLL_CTL_ADD, fd, &event) == 0) {
+        return true;
+    }
+
+    SCRAPS_LOG_ERROR("error adding file descriptor to epoll instance (fd = {}, errno = {})", fd, static_cast<int>(errno));
+    return false;
+}
+
+void EpollPoller::remove(int fd) {
+    // fails harmlessly if the descriptor was already closed
+    epoll_ctl(_epollFD, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+bool EpollPoller::wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) {
+    int result = -1;
+
+#ifdef __NR_epoll_pwait2
+    // epoll_pwait2 takes a timespec, but requires Linux 5.11. it's invoked directly since older
+    // libcs don't wrap it
+    if (_hasPwait2) {
+        __kernel_timespec ts;
+        ts.tv_sec = timeout.count() / 1000000000;
+        ts.tv_nsec = timeout.count() % 1000000000;
+        result = static_cast<int>(syscall(__NR_epoll_pwait2, _epollFD, _buffer.data(), static_cast<int>(_buffer.size()), timeout.count() < 0 ? nullptr : &ts, nullptr, 0));
+        if (result < 0 && errno == ENOSYS) {
+            _hasPwait2 = false;
+        }
+    }
+
+    if (!_hasPwait2) {
+        result = epoll_wait(_epollFD, _buffer.data(), _buffer.size(), TimeoutMilliseconds(timeout));
+    }
+#else
+    result = epoll_wait(_epollFD, _buffer.data(), _buffer.size(), TimeoutMilliseconds(timeout));
+#endif
+
+    if (result < 0) {
+        return errno == EINTR;
+    }
+
+    events->reserve(events->size() + result);
+    for (int i = 0; i < result; ++i) {
+        events->push_back({_buffer[i].data.fd, FromEpollEvents(_buffer[i].events)});
+    }
+
+    if (static_cast<size_t>(result) == _buffer.size()) {
+        // anything left over will be picked up by the next wait, but there's clearly enough
+        // activity to warrant a bigger buffer
+        _buffer.resize(_buffer.size() * 2);
+    }
+
+    return true;
+}
+
+} // namespace scraps::poller
+
+#endif
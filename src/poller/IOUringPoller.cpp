@@ -0,0 +1,307 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/poller/IOUringPoller.h>
+
+#if SCRAPS_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace scraps::poller {
+
+constexpr unsigned IOUringPoller::kDefaultEntries;
+
+namespace {
+
+constexpr uint64_t kIgnoredUserData = ~uint64_t{0};
+
+uint64_t UserData(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+int IOUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IOUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+} // anonymous namespace
+
+/**
+* The shared memory rings and the bookkeeping needed to produce and consume them.
+*/
+struct IOUringPoller::Ring {
+    ~Ring() {
+        if (sqes) { munmap(sqes, sqesSize); }
+        if (cqRing && cqRing != sqRing) { munmap(cqRing, cqRingSize); }
+        if (sqRing) { munmap(sqRing, sqRingSize); }
+        if (fd >= 0) { ::close(fd); }
+    }
+
+    int fd = -1;
+
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* sqArray = nullptr;
+    unsigned sqLocalTail = 0;
+
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned unsubmitted() const {
+        return sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    bool hasCompletions() const {
+        return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) != *cqHead;
+    }
+
+    /**
+    * Publishes queued submissions and optionally waits for completions.
+    */
+    int enter(unsigned minComplete, const __kernel_timespec* timeout) {
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(timeout);
+
+        auto flags = IORING_ENTER_EXT_ARG | (minComplete ? IORING_ENTER_GETEVENTS : 0);
+        return IOUringEnter(fd, unsubmitted(), minComplete, flags, &arg, sizeof(arg));
+    }
+
+    io_uring_sqe* nextSQE() {
+        if (unsubmitted() == sqEntries) {
+            // the submission queue is full. push it to the kernel to make room
+            if (enter(0, nullptr) < 0 || unsubmitted() == sqEntries) {
+                SCRAPS_LOG_ERROR("io_uring submission queue overflow (errno = {})", static_cast<int>(errno));
+                return nullptr;
+            }
+        }
+        auto index = sqLocalTail & sqMask;
+        auto sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray[index] = index;
+        ++sqLocalTail;
+        return sqe;
+    }
+};
+
+std::unique_ptr<IOUringPoller> IOUringPoller::Create(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP;
+
+    auto ring = std::make_unique<Ring>();
+    ring->fd = IOUringSetup(entries, &params);
+    if (ring->fd < 0) {
+        SCRAPS_LOG_WARNING("unable to set up io_uring (errno = {})", static_cast<int>(errno));
+        return nullptr;
+    }
+
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+        SCRAPS_LOG_WARNING("io_uring is missing required features (features = {})", params.features);
+        return nullptr;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+    }
+
+    ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        ring->sqRing = nullptr;
+        SCRAPS_LOG_ERROR("unable to map io_uring submission queue (errno = {})", static_cast<int>(errno));
+        return nullptr;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            ring->cqRing = nullptr;
+            SCRAPS_LOG_ERROR("unable to map io_uring completion queue (errno = {})", static_cast<int>(errno));
+            return nullptr;
+        }
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    auto sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        SCRAPS_LOG_ERROR("unable to map io_uring submission entries (errno = {})", static_cast<int>(errno));
+        return nullptr;
+    }
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    auto sq = static_cast<char*>(ring->sqRing);
+    ring->sqHead    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sqTail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sqMask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sqEntries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    ring->sqArray   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->sqLocalTail = *ring->sqTail;
+
+    auto cq = static_cast<char*>(ring->cqRing);
+    ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes   = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return std::unique_ptr<IOUringPoller>(new IOUringPoller(std::move(ring)));
+}
+
+IOUringPoller::IOUringPoller(std::unique_ptr<Ring> ring) : _ring{std::move(ring)} {}
+
+IOUringPoller::~IOUringPoller() = default;
+
+bool IOUringPoller::set(int fd, short events) {
+    auto& registration = _registrations[fd];
+
+    if (registration.armed) {
+        if (registration.events == events) {
+            return true;
+        }
+        _disarm(fd, registration);
+    }
+
+    registration.events = events;
+    registration.generation = ++_generation;
+    _arm(fd, &registration);
+
+    if (!registration.armed) {
+        _registrations.erase(fd);
+        return false;
+    }
+
+    return true;
+}
+
+void IOUringPoller::remove(int fd) {
+    auto it = _registrations.find(fd);
+    if (it == _registrations.end()) { return; }
+
+    if (it->second.armed) {
+        _disarm(fd, it->second);
+    }
+    _registrations.erase(it);
+}
+
+bool IOUringPoller::wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) {
+    // poll requests are one-shot, so re-arm anything that fired last time to get level-triggered
+    // behavior. this is batched into the same system call as the wait
+    for (auto fd : _completed) {
+        auto it = _registrations.find(fd);
+        if (it != _registrations.end() && !it->second.armed) {
+            _arm(fd, &it->second);
+        }
+    }
+    _completed.clear();
+
+    __kernel_timespec ts;
+    ts.tv_sec = timeout.count() / 1000000000;
+    ts.tv_nsec = timeout.count() % 1000000000;
+
+    auto minComplete = (timeout.count() == 0 || _ring->hasCompletions()) ? 0 : 1;
+    if (_ring->enter(minComplete, timeout.count() < 0 ? nullptr : &ts) < 0) {
+        // EBUSY means completions have overflowed into the kernel's backlog. reap what we have
+        // so they can be flushed
+        if (errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            return false;
+        }
+    }
+
+    auto head = *_ring->cqHead;
+    auto tail = __atomic_load_n(_ring->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+        auto& cqe = _ring->cqes[head & _ring->cqMask];
+        if (cqe.user_data == kIgnoredUserData) { continue; }
+
+        auto fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+        auto generation = static_cast<uint32_t>(cqe.user_data >> 32);
+
+        auto it = _registrations.find(fd);
+        if (it == _registrations.end() || it->second.generation != generation || !it->second.armed) {
+            // stale completion for a request that has since been removed or replaced
+            continue;
+        }
+
+        it->second.armed = false;
+        _completed.push_back(fd);
+
+        if (cqe.res >= 0) {
+            events->push_back({fd, static_cast<short>(cqe.res)});
+        } else if (cqe.res != -ECANCELED) {
+            events->push_back({fd, POLLNVAL});
+        }
+    }
+
+    __atomic_store_n(_ring->cqHead, head, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+void IOUringPoller::_arm(int fd, Registration* registration) {
+    auto sqe = _ring->nextSQE();
+    if (!sqe) { return; }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    auto mask = static_cast<uint32_t>(static_cast<uint16_t>(registration->events));
+    sqe->poll32_events = (mask << 16) | (mask >> 16);
+#else
+    sqe->poll32_events = static_cast<uint16_t>(registration->events);
+#endif
+    sqe->user_data = UserData(fd, registration->generation);
+
+    registration->armed = true;
+}
+
+void IOUringPoller::_disarm(int fd, const Registration& registration) {
+    auto sqe = _ring->nextSQE();
+    if (!sqe) { return; }
+
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = UserData(fd, registration.generation);
+    sqe->user_data = kIgnoredUserData;
+}
+
+} // namespace scraps::poller
+
+#endif
@@ -0,0 +1,75 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/poller/PollPoller.h>
+
+#include <cerrno>
+
+namespace scraps::poller {
+
+bool PollPoller::set(int fd, short events) {
+    auto it = _indices.find(fd);
+    if (it != _indices.end()) {
+        _descriptors[it->second].events = events;
+        return true;
+    }
+
+    _indices.emplace(fd, _descriptors.size());
+    _descriptors.emplace_back();
+    auto& pfd = _descriptors.back();
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    return true;
+}
+
+void PollPoller::remove(int fd) {
+    auto it = _indices.find(fd);
+    if (it == _indices.end()) { return; }
+
+    auto index = it->second;
+    _indices.erase(it);
+
+    if (index != _descriptors.size() - 1) {
+        _descriptors[index] = _descriptors.back();
+        _indices[_descriptors[index].fd] = index;
+    }
+    _descriptors.pop_back();
+}
+
+bool PollPoller::wait(std::vector<Event>* events, std::chrono::nanoseconds timeout) {
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    timespec ts;
+    ts.tv_sec = timeout.count() / 1000000000;
+    ts.tv_nsec = timeout.count() % 1000000000;
+    auto result = ::ppoll(_descriptors.data(), _descriptors.size(), timeout.count() < 0 ? nullptr : &ts, nullptr);
+#else
+    auto result = ::poll(_descriptors.data(), _descriptors.size(), TimeoutMilliseconds(timeout));
+#endif
+
+    if (result < 0) {
+        return errno == EINTR;
+    }
+
+    for (auto it = _descriptors.begin(); result > 0 && it != _descriptors.end(); ++it) {
+        if (!it->revents) { continue; }
+        --result;
+        events->push_back({it->fd, it->revents});
+    }
+
+    return true;
+}
+
+} // namespace scraps::poller
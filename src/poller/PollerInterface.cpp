@@ -0,0 +1,33 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/poller/PollerInterface.h>
+
+#include <scraps/poller/EpollPoller.h>
+#include <scraps/poller/PollPoller.h>
+
+namespace scraps::poller {
+
+std::unique_ptr<PollerInterface> CreateDefaultPoller() {
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+    if (auto poller = EpollPoller::Create()) {
+        return poller;
+    }
+    SCRAPS_LOG_WARNING("falling back to poll");
+#endif
+    return std::make_unique<PollPoller>();
+}
+
+} // namespace scraps::poller
@@ -0,0 +1,58 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/RunLoop.h>
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace scraps;
+
+namespace {
+RunLoop& SharedRunLoop() {
+    // intentionally leaked along with its thread so that it outlives every benchmark
+    static auto runLoop = [] {
+        auto runLoop = new RunLoop;
+        std::thread([runLoop] { runLoop->run(); }).detach();
+        return runLoop;
+    }();
+    return *runLoop;
+}
+} // anonymous namespace
+
+static void RunLoopAsync(benchmark::State& state) {
+    auto& runLoop = SharedRunLoop();
+    while (state.KeepRunning()) {
+        runLoop.async([] {});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(RunLoopAsync)->ThreadRange(1, 8)->UseRealTime();
+
+static void RunLoopAsyncLatency(benchmark::State& state) {
+    auto& runLoop = SharedRunLoop();
+    std::atomic<bool> done;
+    while (state.KeepRunning()) {
+        done = false;
+        runLoop.async([&] { done = true; });
+        while (!done) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+BENCHMARK(RunLoopAsyncLatency)->UseRealTime();
@@ -0,0 +1,104 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/net/SockAddr.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace scraps;
+using namespace scraps::net;
+
+namespace {
+
+std::vector<Endpoint> TestEndpoints() {
+    std::vector<Endpoint> endpoints;
+    for (uint16_t port = 1; port <= 64; ++port) {
+        endpoints.emplace_back(Address::from_string("192.168.1.1"), port);
+        endpoints.emplace_back(Address::from_string("2001:db8::1"), port);
+    }
+    return endpoints;
+}
+
+} // anonymous namespace
+
+static void EndpointHash(benchmark::State& state) {
+    auto endpoints = TestEndpoints();
+    std::hash<Endpoint> hasher;
+    size_t hash = 0;
+    while (state.KeepRunning()) {
+        for (auto& endpoint : endpoints) {
+            hash ^= hasher(endpoint);
+        }
+    }
+    benchmark::DoNotOptimize(hash);
+    state.SetItemsProcessed(state.iterations() * endpoints.size());
+}
+
+BENCHMARK(EndpointHash);
+
+static void SockAddrHash(benchmark::State& state) {
+    auto endpoints = TestEndpoints();
+    std::vector<SockAddr> addresses(endpoints.begin(), endpoints.end());
+    std::hash<SockAddr> hasher;
+    size_t hash = 0;
+    while (state.KeepRunning()) {
+        for (auto& address : addresses) {
+            hash ^= hasher(address);
+        }
+    }
+    benchmark::DoNotOptimize(hash);
+    state.SetItemsProcessed(state.iterations() * addresses.size());
+}
+
+BENCHMARK(SockAddrHash);
+
+// what receiving used to do for every datagram
+static void EndpointFromSockaddr(benchmark::State& state) {
+    auto endpoints = TestEndpoints();
+    std::vector<sockaddr_storage> natives(endpoints.size());
+    std::vector<socklen_t> lengths(endpoints.size());
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        endpoints[i].getSockAddr(&natives[i], &lengths[i]);
+    }
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < natives.size(); ++i) {
+            auto endpoint = Endpoint::FromSockaddr(reinterpret_cast<sockaddr*>(&natives[i]), lengths[i]);
+            benchmark::DoNotOptimize(endpoint);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * natives.size());
+}
+
+BENCHMARK(EndpointFromSockaddr);
+
+static void SockAddrFromSockaddr(benchmark::State& state) {
+    auto endpoints = TestEndpoints();
+    std::vector<sockaddr_storage> natives(endpoints.size());
+    std::vector<socklen_t> lengths(endpoints.size());
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        endpoints[i].getSockAddr(&natives[i], &lengths[i]);
+    }
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < natives.size(); ++i) {
+            SockAddr address{reinterpret_cast<sockaddr*>(&natives[i]), lengths[i]};
+            benchmark::DoNotOptimize(address);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * natives.size());
+}
+
+BENCHMARK(SockAddrFromSockaddr);
@@ -0,0 +1,64 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/TaskQueue.h>
+
+#include <benchmark/benchmark.h>
+
+using namespace scraps;
+
+static void TaskQueueAsync(benchmark::State& state) {
+    TaskQueue queue;
+    int counter = 0;
+    while (state.KeepRunning()) {
+        queue.async([&] { ++counter; });
+        queue.run();
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(TaskQueueAsync);
+
+static void TaskQueuePost(benchmark::State& state) {
+    TaskQueue queue;
+    int counter = 0;
+    while (state.KeepRunning()) {
+        queue.post([&] { ++counter; });
+        queue.run();
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(TaskQueuePost);
+
+static void TaskQueuePostWithPendingTimers(benchmark::State& state) {
+    TaskQueue queue;
+    for (int i = 0; i < state.range(0); ++i) {
+        queue.postAfter(std::chrono::hours(1), [] {});
+    }
+    int counter = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 64; ++i) {
+            queue.post([&] { ++counter; });
+        }
+        queue.run();
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+
+BENCHMARK(TaskQueuePostWithPendingTimers)->Arg(0)->Arg(1024)->Arg(65536);
@@ -0,0 +1,57 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/TaskThread.h>
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace scraps;
+
+static void TaskThreadPost(benchmark::State& state) {
+    TaskThread thread;
+    std::atomic<int64_t> counter{0};
+    int64_t expected = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < state.range(0); ++i) {
+            thread.post([&] { ++counter; });
+        }
+        expected += state.range(0);
+        while (counter < expected) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(TaskThreadPost)->Range(8, 1024)->UseRealTime();
+
+static void TaskThreadPostBatch(benchmark::State& state) {
+    TaskThread thread;
+    std::atomic<int64_t> counter{0};
+    int64_t expected = 0;
+    std::vector<std::function<void()>> batch(state.range(0), [&] { ++counter; });
+    while (state.KeepRunning()) {
+        thread.postBatch(batch.begin(), batch.end());
+        expected += state.range(0);
+        while (counter < expected) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(TaskThreadPostBatch)->Range(8, 1024)->UseRealTime();
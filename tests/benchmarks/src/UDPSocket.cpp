@@ -0,0 +1,139 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <scraps/net/UDPSocket.h>
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace scraps;
+using namespace scraps::net;
+
+namespace {
+
+constexpr size_t kDatagrams = 32;
+
+struct CountingReceiver : UDPReceiver {
+    virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override { ++received; }
+    size_t received = 0;
+};
+
+struct Fixture {
+    explicit Fixture(size_t payloadSize) : payload(payloadSize) {
+        sender.bind("127.0.0.1", 10070);
+        receiverSocket.bind("127.0.0.1", 10071);
+        for (size_t i = 0; i < kDatagrams; ++i) {
+            datagrams[i].destination = Endpoint{Address::from_string("127.0.0.1"), 10071};
+            datagrams[i].data = payload.data();
+            datagrams[i].length = payload.size();
+        }
+    }
+
+    std::shared_ptr<CountingReceiver> receiver = std::make_shared<CountingReceiver>();
+    UDPSocket sender{UDPSocket::Protocol::kIPv4};
+    UDPSocket receiverSocket{UDPSocket::Protocol::kIPv4, receiver};
+    std::vector<char> payload;
+    UDPSender::Datagram datagrams[kDatagrams];
+};
+
+} // anonymous namespace
+
+// one sendto per datagram and one recvfrom per datagram, as UDPSocket did before batching
+static void UDPSocketSendReceive(benchmark::State& state) {
+    Fixture fixture{static_cast<size_t>(state.range(0))};
+    unsigned char buffer[4096];
+    while (state.KeepRunning()) {
+        for (auto& datagram : fixture.datagrams) {
+            fixture.sender.send(datagram.destination, datagram.data, datagram.length);
+        }
+        for (size_t i = 0; i < kDatagrams; ++i) {
+            sockaddr_storage address;
+            socklen_t addressLength = sizeof(address);
+            if (::recvfrom(fixture.receiverSocket.native(), buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&address), &addressLength) > 0) {
+                fixture.receiver->receiveUDP(Endpoint::FromSockaddr(reinterpret_cast<sockaddr*>(&address), addressLength), buffer, fixture.payload.size());
+            }
+        }
+    }
+    benchmark::DoNotOptimize(fixture.receiver->received);
+    state.SetItemsProcessed(state.iterations() * kDatagrams);
+    state.SetBytesProcessed(state.iterations() * kDatagrams * state.range(0));
+}
+
+BENCHMARK(UDPSocketSendReceive)->Arg(64)->Arg(1200);
+
+static void UDPSocketSendReceiveBatch(benchmark::State& state) {
+    Fixture fixture{static_cast<size_t>(state.range(0))};
+    while (state.KeepRunning()) {
+        fixture.sender.sendBatch(fixture.datagrams, kDatagrams);
+        fixture.receiverSocket.receive();
+    }
+    benchmark::DoNotOptimize(fixture.receiver->received);
+    state.SetItemsProcessed(state.iterations() * kDatagrams);
+    state.SetBytesProcessed(state.iterations() * kDatagrams * state.range(0));
+}
+
+BENCHMARK(UDPSocketSendReceiveBatch)->Arg(64)->Arg(1200);
+
+static void UDPSocketSendReceiveOffload(benchmark::State& state) {
+    Fixture fixture{static_cast<size_t>(state.range(0))};
+    if (!fixture.sender.setSegmentationOffload(true) || !fixture.receiverSocket.setSegmentationOffload(true)) {
+        state.SkipWithError("segmentation offload is not supported");
+    }
+    while (state.KeepRunning()) {
+        fixture.sender.sendBatch(fixture.datagrams, kDatagrams);
+        fixture.receiverSocket.receive();
+    }
+    benchmark::DoNotOptimize(fixture.receiver->received);
+    state.SetItemsProcessed(state.iterations() * kDatagrams);
+    state.SetBytesProcessed(state.iterations() * kDatagrams * state.range(0));
+}
+
+BENCHMARK(UDPSocketSendReceiveOffload)->Arg(64)->Arg(1200);
+
+// threads sending through one socket while also receiving on it, as a busy node would. sending
+// doesn't lock, so senders only contend with each other in the kernel
+static void UDPSocketConcurrentSend(benchmark::State& state) {
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override { ++received; }
+        std::atomic<size_t> received{0};
+    };
+
+    struct Shared {
+        Shared() {
+            socket.bind("127.0.0.1", 10072);
+        }
+
+        std::shared_ptr<Receiver> receiver = std::make_shared<Receiver>();
+        UDPSocket socket{UDPSocket::Protocol::kIPv4, receiver};
+        SockAddr destination{Address::from_string("127.0.0.1"), 10072};
+    };
+
+    static Shared shared;
+    char payload[64] = {};
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kDatagrams; ++i) {
+            shared.socket.send(shared.destination, payload, sizeof(payload));
+        }
+        shared.socket.receive();
+    }
+    state.SetItemsProcessed(state.iterations() * kDatagrams);
+    state.SetBytesProcessed(state.iterations() * kDatagrams * sizeof(payload));
+}
+
+BENCHMARK(UDPSocketConcurrentSend)->ThreadRange(1, 8)->UseRealTime();
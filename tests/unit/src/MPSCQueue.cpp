@@ -0,0 +1,81 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "gtest.h"
+
+#include <scraps/MPSCQueue.h>
+
+#include <thread>
+
+using namespace scraps;
+
+TEST(MPSCQueue, basicOperation) {
+    MPSCQueue<std::unique_ptr<int>> queue;
+    std::unique_ptr<int> value;
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(&value));
+
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+    EXPECT_FALSE(queue.empty());
+
+    ASSERT_TRUE(queue.pop(&value));
+    EXPECT_EQ(*value, 1);
+    ASSERT_TRUE(queue.pop(&value));
+    EXPECT_EQ(*value, 2);
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(&value));
+
+    // elements left in the queue are destroyed with it
+    queue.push(std::make_unique<int>(3));
+}
+
+TEST(MPSCQueue, multipleProducers) {
+    constexpr int kProducers = 4;
+    constexpr int kElementsPerProducer = 100000;
+
+    MPSCQueue<std::pair<int, int>> queue;
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < kProducers; ++i) {
+        producers.emplace_back([&, i] {
+            for (int j = 0; j < kElementsPerProducer; ++j) {
+                queue.push({i, j});
+            }
+        });
+    }
+
+    // each producer's elements are popped in order
+    std::vector<int> next(kProducers, 0);
+    int remaining = kProducers * kElementsPerProducer;
+    std::pair<int, int> element;
+    while (remaining) {
+        if (!queue.pop(&element)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(element.second, next[element.first]);
+        ++next[element.first];
+        --remaining;
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_TRUE(queue.empty());
+}
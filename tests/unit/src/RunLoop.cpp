@@ -16,6 +16,8 @@
 #include "gtest.h"
 
 #include <scraps/RunLoop.h>
+#include <scraps/poller/IOUringPoller.h>
+#include <scraps/poller/PollPoller.h>
 
 #include <thread>
 #include <sys/socket.h>
@@ -47,9 +49,153 @@ TEST(RunLoop, async) {
     EXPECT_EQ(x, 3);
 };
 
-TEST(RunLoop, events) {
+TEST(RunLoop, cancelAsync) {
+    RunLoop runLoop;
+
+    auto value = std::make_shared<int>(0);
+    auto handle = runLoop.async([&, value] { *value = 1; }, 50ms);
+    runLoop.async([&] { runLoop.cancel(); }, 100ms);
+    EXPECT_EQ(value.use_count(), 2);
+
+    EXPECT_TRUE(handle.cancel());
+    EXPECT_EQ(value.use_count(), 1);
+    EXPECT_FALSE(handle.cancel());
+
+    auto immediate = runLoop.async([&] { *value = 2; });
+    EXPECT_TRUE(immediate.cancel());
+
+    runLoop.run();
+
+    EXPECT_EQ(*value, 0);
+    EXPECT_FALSE(RunLoop::TimerHandle{}.cancel());
+}
+
+TEST(RunLoop, rescheduleAsync) {
+    RunLoop runLoop;
+
+    std::vector<int> order;
+    auto later = runLoop.async([&] { order.push_back(1); }, 10ms);
+    auto sooner = runLoop.async([&] { order.push_back(0); }, 10s);
+    runLoop.async([&] { runLoop.cancel(); }, 100ms);
+
+    EXPECT_TRUE(later.reschedule(50ms));
+    EXPECT_TRUE(sooner.reschedule(20ms));
+
+    runLoop.run();
+
+    EXPECT_EQ(order, std::vector<int>({0, 1}));
+    EXPECT_FALSE(later.reschedule(10ms));
+    EXPECT_FALSE(later.cancel());
+    EXPECT_FALSE(RunLoop::TimerHandle{}.reschedule(10ms));
+}
+
+TEST(RunLoop, resetCancelsTimers) {
+    RunLoop runLoop;
+
+    auto value = std::make_shared<int>(0);
+    auto scheduled = runLoop.async([value] { *value = 1; }, 10s);
+    runLoop.async([&] { runLoop.cancel(); }, 20ms);
+    runLoop.run();
+
+    // this one never makes it out of the submission queue
+    auto queued = runLoop.async([value] { *value = 2; }, 10s);
+
+    runLoop.reset();
+    EXPECT_EQ(value.use_count(), 1);
+
+    // the new timers take over the dropped timers' slots, but the stale handles can't touch them
+    bool invoked = false;
+    runLoop.async([&] { invoked = true; }, 50ms);
+    runLoop.async([&] { runLoop.cancel(); }, 100ms);
+
+    EXPECT_FALSE(scheduled.cancel());
+    EXPECT_FALSE(scheduled.reschedule(10s));
+    EXPECT_FALSE(queued.cancel());
+    EXPECT_FALSE(queued.reschedule(10s));
+
+    runLoop.run();
+
+    EXPECT_TRUE(invoked);
+    EXPECT_EQ(*value, 0);
+}
+
+TEST(RunLoop, highResolutionTimers) {
+    RunLoop runLoop{50us};
+
+    // with millisecond precision, each of these would take roughly a millisecond
+    constexpr int kTimers = 20;
+    constexpr auto kDelay = 250us;
+
+    int remaining = kTimers;
+    std::function<void()> next = [&] {
+        if (--remaining) {
+            runLoop.async(next, kDelay);
+        } else {
+            runLoop.cancel();
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    runLoop.async(next, kDelay);
+    runLoop.run();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_GE(elapsed, kTimers * kDelay);
+    EXPECT_LT(elapsed, kTimers * 750us);
+}
+
+TEST(RunLoop, multipleProducers) {
+    constexpr int kProducers = 4;
+    constexpr int kFunctionsPerProducer = 10000;
+
     RunLoop runLoop;
+    std::thread thread{[&] { runLoop.run(); }};
 
+    // functions from each producer run in order, and none are lost even if the loop is blocked
+    std::vector<int> next(kProducers, 0);
+    std::atomic<int> remaining{kProducers * kFunctionsPerProducer};
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < kProducers; ++i) {
+        producers.emplace_back([&, i] {
+            for (int j = 0; j < kFunctionsPerProducer; ++j) {
+                runLoop.async([&, i, j] {
+                    EXPECT_EQ(next[i]++, j);
+                    if (!--remaining) {
+                        runLoop.cancel();
+                    }
+                });
+                if (j % 1000 == 0) {
+                    std::this_thread::sleep_for(1ms);
+                }
+            }
+        });
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    thread.join();
+
+    EXPECT_EQ(remaining, 0);
+}
+
+TEST(RunLoop, asyncOrder) {
+    RunLoop runLoop;
+
+    std::vector<int> order;
+    runLoop.async([&] { order.push_back(3); }, 30ms);
+    runLoop.async([&] { order.push_back(2); }, 20ms);
+    runLoop.async([&] { order.push_back(0); });
+    runLoop.async([&] { order.push_back(1); });
+    runLoop.async([&] { runLoop.cancel(); }, 40ms);
+
+    runLoop.run();
+
+    EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+}
+
+static void EventsTest(RunLoop& runLoop) {
     int sockets[2];
     EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
 
@@ -71,7 +217,29 @@ TEST(RunLoop, events) {
 
     close(sockets[0]);
     close(sockets[1]);
+}
+
+TEST(RunLoop, events) {
+    RunLoop runLoop;
+    EventsTest(runLoop);
+};
+
+TEST(RunLoop, pollPoller) {
+    RunLoop runLoop{std::make_unique<poller::PollPoller>()};
+    EventsTest(runLoop);
+};
+
+#if SCRAPS_IO_URING
+TEST(RunLoop, ioUringPoller) {
+    auto poller = poller::IOUringPoller::Create();
+    if (!poller) {
+        fprintf(stderr, "io_uring isn't available. skipping test.\n");
+        return;
+    }
+    RunLoop runLoop{std::move(poller)};
+    EventsTest(runLoop);
 };
+#endif
 
 TEST(RunLoop, cancelDoesntDeadlock) {
     // Ensures that canceling the run immediately after starting it doesn't
@@ -0,0 +1,82 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "gtest.h"
+
+#include <scraps/RunLoopGroup.h>
+
+#include <set>
+
+using namespace scraps;
+
+TEST(RunLoopGroup, basicOperation) {
+    RunLoopGroup group{4};
+    ASSERT_EQ(group.size(), 4);
+    EXPECT_FALSE(group.currentIndex());
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> started{0}, stopped{0}, invoked{0};
+
+    group.start([&](size_t index) {
+        EXPECT_EQ(group.currentIndex(), index);
+        ++started;
+    }, [&](size_t index) {
+        EXPECT_EQ(group.currentIndex(), index);
+        ++stopped;
+    });
+
+    for (size_t i = 0; i < group.size(); ++i) {
+        group.loop(i).async([&, i] {
+            EXPECT_TRUE(group.isCurrentThread());
+            EXPECT_EQ(group.currentIndex(), i);
+
+            std::lock_guard<std::mutex> lock{mutex};
+            threads.insert(std::this_thread::get_id());
+            ++invoked;
+        });
+    }
+
+    while (invoked < 4) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    group.stop();
+    group.wait();
+
+    EXPECT_EQ(threads.size(), 4);
+    EXPECT_EQ(started, 4);
+    EXPECT_EQ(stopped, 4);
+    EXPECT_FALSE(group.isCurrentThread());
+
+    // the group can be restarted
+    group.start();
+    group.loop(3).async([&] { ++invoked; });
+    while (invoked < 5) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+TEST(RunLoopGroup, shard) {
+    RunLoopGroup group{3};
+    EXPECT_EQ(group.shard(0), 0);
+    EXPECT_EQ(group.shard(4), 1);
+    EXPECT_EQ(group.shard(8), 2);
+}
+
+TEST(RunLoopGroup, hardwareConcurrency) {
+    RunLoopGroup group{0};
+    EXPECT_EQ(group.size(), std::max(std::thread::hardware_concurrency(), 1u));
+}
@@ -0,0 +1,214 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "gtest.h"
+
+#include <scraps/TaskPool.h>
+
+#include <set>
+
+using namespace scraps;
+
+// Realtime tests almost always fail with Valgrind
+#ifndef VALGRIND
+TEST(TaskPool, basicFunctionality) {
+    TaskPool scheduler{4};
+    EXPECT_EQ(scheduler.size(), 4);
+
+    auto argFunc = [](int x, float y, double z) { return x + y + z; };
+
+    auto f1 = scheduler.async(argFunc, 1, 2, 3);
+    auto f2 = scheduler.async(argFunc, 1, 2.0f, 3.0);
+    EXPECT_EQ(f1.get(), 6);
+    EXPECT_EQ(f2.get(), 6);
+
+    std::atomic<int> first{0};
+    scheduler.asyncAfter(20ms, [&] {
+        int expected = 0;
+        first.compare_exchange_strong(expected, 1);
+    });
+    scheduler.asyncAfter(5ms, [&] {
+        int expected = 0;
+        first.compare_exchange_strong(expected, 2);
+    });
+
+    std::this_thread::sleep_for(40ms);
+
+    EXPECT_EQ(first, 2);
+}
+
+TEST(TaskPool, timers) {
+    TaskPool scheduler{4};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::future<std::chrono::steady_clock::time_point>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.emplace_back(scheduler.asyncAt(start + std::chrono::microseconds(i * 100), [] { return std::chrono::steady_clock::now(); }));
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        auto invoked = futures[i].get();
+        EXPECT_GE(invoked, start + std::chrono::microseconds(i * 100));
+        EXPECT_LT(invoked, start + std::chrono::microseconds(i * 100) + 50ms);
+    }
+}
+
+TEST(TaskPool, stealing) {
+    TaskPool scheduler{4};
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    // the children are all pushed onto the parent's worker, which blocks until they're done, so
+    // they can only complete if other workers steal them
+    auto parent = scheduler.async([&] {
+        std::vector<std::future<void>> children;
+        for (int i = 0; i < 8; ++i) {
+            children.emplace_back(scheduler.async([&] {
+                std::this_thread::sleep_for(5ms);
+                std::lock_guard<std::mutex> lock{mutex};
+                threads.insert(std::this_thread::get_id());
+            }));
+        }
+        for (auto& child : children) {
+            if (child.wait_for(5s) != std::future_status::ready) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    EXPECT_TRUE(parent.get());
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(TaskPool, manyTasks) {
+    TaskPool scheduler{4};
+
+    std::atomic<int> count{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 10000; ++i) {
+        futures.emplace_back(scheduler.async([&] { ++count; }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    EXPECT_EQ(count, 10000);
+}
+
+TEST(TaskPool, cancelAndJoin) {
+    TaskPool scheduler{2};
+
+    std::atomic<size_t> invocations{0};
+    std::function<void()> repeat;
+    repeat = [&] {
+        ++invocations;
+        std::this_thread::sleep_for(100ms);
+        scheduler.async(repeat);
+    };
+    scheduler.async(repeat);
+    while (invocations < 1);
+    scheduler.cancelAndJoin();
+    auto f = scheduler.async(repeat);
+
+    std::this_thread::sleep_for(300ms);
+    EXPECT_LE(invocations, 2);
+    EXPECT_EQ(f.wait_for(0s), std::future_status::ready);
+}
+
+TEST(TaskPool, scopeFunctionality) {
+    {
+        TaskPool scheduler{2};
+
+        TaskPool::TaskScope scope;
+
+        std::atomic<bool> executed1{false};
+        scheduler.async(scope, [&] { executed1 = true; });
+
+        std::this_thread::sleep_for(10ms);
+
+        scope.endScope();
+
+        std::atomic<bool> executed2{false};
+        scheduler.async(scope, [&] { executed2 = true; });
+
+        std::this_thread::sleep_for(10ms);
+
+        EXPECT_EQ(executed1, true);
+        EXPECT_EQ(executed2, false);
+    }
+
+    {
+        TaskPool scheduler{2};
+
+        auto scope = std::make_unique<TaskPool::TaskScope>();
+
+        std::atomic<bool> executed1{false};
+        scheduler.async(*scope,
+                        [&] {
+                            executed1 = true;
+                            std::this_thread::sleep_for(100ms);
+                        });
+
+        std::atomic<bool> executed2{false};
+        scheduler.asyncAfter(*scope, 50ms, [&] { executed2 = true; });
+
+        std::this_thread::sleep_for(10ms); // let the first task get going, but not end yet before resetting the scope
+
+        scope.reset(); // will block until task1 is done
+
+        std::this_thread::sleep_for(100ms);
+
+        EXPECT_EQ(executed1, true);
+        EXPECT_EQ(executed2, false);
+    }
+}
+
+TEST(TaskPool, scopeRemoval) {
+    TaskPool scheduler{2};
+
+    TaskPool::TaskScope scope;
+
+    auto test     = std::make_shared<int>(7);
+    auto weakTest = std::weak_ptr<int>{test};
+
+    scheduler.asyncAfter(scope, 5s, [test = std::move(test)]{});
+
+    EXPECT_EQ((bool)weakTest.lock(), true);
+
+    scope.endScope();
+
+    EXPECT_EQ((bool)weakTest.lock(), false);
+}
+TEST(TaskPool, batch) {
+    TaskPool scheduler{4};
+
+    std::atomic<int> count{0};
+    std::vector<std::function<void()>> functions(1000, [&] { ++count; });
+
+    auto futures = scheduler.asyncBatch(functions.begin(), functions.end());
+    for (auto& future : futures) {
+        future.get();
+    }
+    EXPECT_EQ(count, 1000);
+
+    scheduler.postBatch(functions.begin(), functions.end());
+    while (count < 2000) {
+        std::this_thread::yield();
+    }
+}
+#endif // VALGRIND
@@ -17,6 +17,10 @@
 
 #include <scraps/TaskQueue.h>
 
+#include <array>
+#include <cstdint>
+#include <thread>
+
 using namespace scraps;
 
 TEST(TaskQueue,  basicFunctionality) {
@@ -51,3 +55,97 @@ TEST(TaskQueue,  basicFunctionality) {
 
     EXPECT_EQ(executed, true);
 }
+
+TEST(TaskQueue, post) {
+    TaskQueue scheduler;
+
+    int sum = 0;
+    scheduler.post([&](int x, int y) { sum += x + y; }, 1, 2);
+    scheduler.postAfter(50ms, [&] { sum += 10; });
+
+    // too big for a pooled block
+    std::array<char, 1024> big{};
+    big[0] = 100;
+    scheduler.post([&, big] { sum += big[0]; });
+
+    EXPECT_EQ(sum, 0);
+
+    scheduler.run();
+
+    EXPECT_EQ(sum, 103);
+
+    std::this_thread::sleep_for(100ms);
+
+    scheduler.run();
+
+    EXPECT_EQ(sum, 113);
+}
+
+TEST(TaskQueue, postOverAligned) {
+    TaskQueue scheduler;
+
+    // small enough for a pooled block, but needs more alignment than the blocks guarantee
+    struct alignas(64) Aligned {
+        int value;
+    };
+
+    bool isAligned = false;
+    int value = 0;
+    Aligned aligned{7};
+    scheduler.post([&, aligned] {
+        isAligned = reinterpret_cast<uintptr_t>(&aligned) % alignof(Aligned) == 0;
+        value = aligned.value;
+    });
+
+    scheduler.run();
+
+    EXPECT_TRUE(isAligned);
+    EXPECT_EQ(value, 7);
+}
+
+TEST(TaskQueue, postFromManyThreads) {
+    TaskQueue scheduler;
+
+    std::atomic<int> count{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; ++j) {
+                scheduler.post([&] { ++count; });
+            }
+        });
+    }
+
+    while (count < 4000) {
+        scheduler.run();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(count, 4000);
+}
+
+TEST(TaskQueue, batch) {
+    TaskQueue scheduler;
+
+    std::vector<std::function<int()>> functions;
+    for (int i = 0; i < 100; ++i) {
+        functions.emplace_back([i] { return i; });
+    }
+
+    auto futures = scheduler.asyncBatch(functions.begin(), functions.end());
+    ASSERT_EQ(futures.size(), 100);
+
+    int count = 0;
+    std::vector<std::function<void()>> posts(50, [&] { ++count; });
+    scheduler.postBatch(posts.begin(), posts.end());
+
+    scheduler.run();
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(futures[i].get(), i);
+    }
+    EXPECT_EQ(count, 50);
+}
@@ -228,4 +228,24 @@ TEST(TaskThread, scopeRemoval) {
         EXPECT_EQ((bool)weakTest.lock(), false);
     }
 }
+TEST(TaskThread, batch) {
+    TaskThread scheduler;
+
+    std::atomic<int> count{0};
+    std::vector<std::function<void()>> functions(100, [&] { ++count; });
+
+    // the thread should wake up for the batch even if it's already waiting on a later task
+    scheduler.asyncAfter(1s, [] {});
+
+    auto futures = scheduler.asyncBatch(functions.begin(), functions.end());
+    for (auto& future : futures) {
+        EXPECT_EQ(future.wait_for(1s), std::future_status::ready);
+    }
+    EXPECT_EQ(count, 100);
+
+    scheduler.postBatch(functions.begin(), functions.end());
+    while (count < 200) {
+        std::this_thread::yield();
+    }
+}
 #endif // VALGRIND
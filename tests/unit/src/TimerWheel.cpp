@@ -0,0 +1,227 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "gtest.h"
+
+#include <scraps/TimerWheel.h>
+
+#include <map>
+#include <random>
+
+using namespace scraps;
+
+namespace {
+const auto kStart = std::chrono::steady_clock::time_point{} + 1000h;
+} // anonymous namespace
+
+TEST(TimerWheel, basicOperation) {
+    TimerWheel<int> wheel{1ms, kStart};
+    std::vector<int> expired;
+
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_FALSE(wheel.nextExpiration());
+
+    wheel.insert(kStart + 5ms, 5);
+    wheel.insert(kStart + 2ms, 2);
+    auto id = wheel.insert(kStart + 3ms, 3);
+    wheel.insert(kStart + 2ms, 20);
+    wheel.insert(kStart, 0);
+    EXPECT_EQ(wheel.size(), 5);
+
+    EXPECT_TRUE(wheel.contains(id));
+    EXPECT_TRUE(wheel.erase(id));
+    EXPECT_FALSE(wheel.contains(id));
+    EXPECT_FALSE(wheel.erase(id));
+    EXPECT_EQ(wheel.size(), 4);
+
+    wheel.expire(kStart, &expired);
+    EXPECT_EQ(expired, std::vector<int>({0}));
+
+    ASSERT_TRUE(wheel.nextExpiration());
+    EXPECT_EQ(*wheel.nextExpiration(), kStart + 2ms);
+
+    expired.clear();
+    wheel.expire(kStart + 1999us, &expired);
+    EXPECT_TRUE(expired.empty());
+
+    wheel.expire(kStart + 4ms, &expired);
+    EXPECT_EQ(expired, std::vector<int>({2, 20}));
+
+    expired.clear();
+    wheel.expire(kStart + 1h, &expired);
+    EXPECT_EQ(expired, std::vector<int>({5}));
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, roundsUp) {
+    TimerWheel<int> wheel{1ms, kStart};
+    std::vector<int> expired;
+
+    wheel.insert(kStart + 1500us, 1);
+
+    wheel.expire(kStart + 1ms, &expired);
+    EXPECT_TRUE(expired.empty());
+
+    wheel.expire(kStart + 1999us, &expired);
+    EXPECT_TRUE(expired.empty());
+
+    wheel.expire(kStart + 2ms, &expired);
+    EXPECT_EQ(expired, std::vector<int>({1}));
+}
+
+TEST(TimerWheel, erasedValue) {
+    TimerWheel<std::shared_ptr<int>> wheel{1ms, kStart};
+
+    auto value = std::make_shared<int>(7);
+    auto id = wheel.insert(kStart + 1s, value);
+    EXPECT_EQ(value.use_count(), 2);
+
+    std::shared_ptr<int> erased;
+    EXPECT_TRUE(wheel.erase(id, &erased));
+    EXPECT_EQ(erased, value);
+
+    erased.reset();
+    EXPECT_EQ(value.use_count(), 1);
+
+    // ids aren't reused
+    auto id2 = wheel.insert(kStart + 1s, value);
+    EXPECT_NE(id, id2);
+    EXPECT_FALSE(wheel.erase(id));
+    EXPECT_TRUE(wheel.contains(id2));
+}
+
+TEST(TimerWheel, clear) {
+    TimerWheel<int> wheel{1ms, kStart};
+    std::vector<int> expired;
+
+    auto id = wheel.insert(kStart + 10ms, 1);
+    wheel.insert(kStart + 20ms, 2);
+    wheel.clear();
+    EXPECT_TRUE(wheel.empty());
+    EXPECT_FALSE(wheel.contains(id));
+
+    // ids aren't reused after clearing either, so the stale id can't erase the new element
+    auto id2 = wheel.insert(kStart + 10ms, 3);
+    EXPECT_NE(id, id2);
+    EXPECT_FALSE(wheel.erase(id));
+    EXPECT_FALSE(wheel.reschedule(id, kStart + 30ms));
+    EXPECT_TRUE(wheel.contains(id2));
+    EXPECT_EQ(wheel.size(), 1);
+
+    wheel.expire(kStart + 10ms, &expired);
+    EXPECT_EQ(expired, std::vector<int>({3}));
+}
+
+TEST(TimerWheel, reschedule) {
+    TimerWheel<int> wheel{1ms, kStart};
+    std::vector<int> expired;
+
+    auto a = wheel.insert(kStart + 10ms, 1);
+    auto b = wheel.insert(kStart + 20ms, 2);
+
+    EXPECT_TRUE(wheel.reschedule(a, kStart + 30ms));
+    EXPECT_TRUE(wheel.reschedule(b, kStart + 5ms));
+
+    wheel.expire(kStart + 25ms, &expired);
+    EXPECT_EQ(expired, std::vector<int>({2}));
+    EXPECT_FALSE(wheel.reschedule(b, kStart + 40ms));
+
+    wheel.expire(kStart + 30ms, &expired);
+    EXPECT_EQ(expired, std::vector<int>({2, 1}));
+}
+
+TEST(TimerWheel, longDelays) {
+    TimerWheel<int> wheel{1ms, kStart};
+    std::vector<int> expired;
+
+    // these land in every level, plus the overflow list
+    std::vector<std::chrono::steady_clock::duration> delays{100ms, 10s, 1h, 10 * 24h, 100 * 24h};
+    for (size_t i = 0; i < delays.size(); ++i) {
+        wheel.insert(kStart + delays[i], static_cast<int>(i));
+    }
+
+    for (size_t i = 0; i < delays.size(); ++i) {
+        expired.clear();
+
+        auto next = wheel.nextExpiration();
+        ASSERT_TRUE(next);
+        EXPECT_LE(*next, kStart + delays[i]);
+
+        wheel.expire(kStart + delays[i] - 1ms, &expired);
+        EXPECT_TRUE(expired.empty());
+
+        wheel.expire(kStart + delays[i], &expired);
+        EXPECT_EQ(expired, std::vector<int>({static_cast<int>(i)}));
+    }
+
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, randomized) {
+    std::mt19937_64 rng{12345};
+    auto resolution = 1ms;
+
+    TimerWheel<size_t> wheel{resolution, kStart};
+    std::map<size_t, std::pair<std::chrono::steady_clock::time_point, TimerWheel<size_t>::Id>> pending;
+    std::vector<size_t> expired;
+
+    auto now = kStart;
+    size_t counter = 0;
+
+    for (int round = 0; round < 2000; ++round) {
+        for (int i = rng() % 20; i > 0; --i) {
+            auto scale = std::chrono::milliseconds(1) * (uint64_t{1} << (rng() % 28));
+            auto deadline = now + std::chrono::microseconds(rng() % std::chrono::duration_cast<std::chrono::microseconds>(scale).count());
+            auto id = wheel.insert(deadline, counter);
+            pending[counter++] = {deadline, id};
+        }
+
+        for (int i = rng() % 5; i > 0 && !pending.empty(); --i) {
+            auto it = pending.begin();
+            std::advance(it, rng() % pending.size());
+            EXPECT_TRUE(wheel.erase(it->second.second));
+            pending.erase(it);
+        }
+
+        // occasionally jump to just before the earliest deadline
+        if (rng() % 10 == 0 && !pending.empty()) {
+            auto earliest = std::min_element(pending.begin(), pending.end(), [](auto& a, auto& b) { return a.second.first < b.second.first; })->second.first;
+            auto next = wheel.nextExpiration();
+            ASSERT_TRUE(next);
+            EXPECT_LT(*next, earliest + resolution);
+            if (earliest - resolution > now) {
+                now = earliest - resolution;
+            }
+        } else {
+            now += std::chrono::microseconds(rng() % 5000000);
+        }
+
+        expired.clear();
+        wheel.expire(now, &expired);
+
+        for (auto value : expired) {
+            auto it = pending.find(value);
+            ASSERT_NE(it, pending.end());
+            EXPECT_LE(it->second.first, now);
+            pending.erase(it);
+        }
+
+        for (auto& kv : pending) {
+            ASSERT_GT(kv.second.first + resolution, now);
+        }
+
+        ASSERT_EQ(wheel.size(), pending.size());
+    }
+}
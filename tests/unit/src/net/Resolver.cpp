@@ -0,0 +1,89 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "../gtest.h"
+
+#include <scraps/net/Resolver.h>
+
+#include <future>
+
+using namespace scraps;
+using namespace scraps::net;
+
+TEST(Resolver, resolve) {
+    Resolver resolver;
+    Resolver::TaskScope scope;
+
+    EXPECT_FALSE(resolver.cached("localhost"));
+
+    std::promise<std::vector<Address>> promise;
+    resolver.resolve(scope, "localhost", [&](std::vector<Address> addresses) {
+        promise.set_value(std::move(addresses));
+    });
+
+    auto addresses = promise.get_future().get();
+    ASSERT_FALSE(addresses.empty());
+    EXPECT_TRUE(addresses[0].is_loopback());
+
+    auto cached = resolver.cached("localhost");
+    ASSERT_TRUE(cached);
+    EXPECT_EQ(*cached, addresses);
+
+    // cached results are delivered immediately
+    bool invoked = false;
+    resolver.resolve(scope, "localhost", [&](std::vector<Address> addresses) {
+        invoked = true;
+    });
+    EXPECT_TRUE(invoked);
+
+    resolver.clearCache();
+    EXPECT_FALSE(resolver.cached("localhost"));
+}
+
+TEST(Resolver, ttl) {
+    Resolver resolver{1, 50ms};
+    Resolver::TaskScope scope;
+
+    std::promise<void> promise;
+    resolver.resolve(scope, "localhost", [&](std::vector<Address> addresses) { promise.set_value(); });
+    promise.get_future().wait();
+
+    EXPECT_TRUE(resolver.cached("localhost"));
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(resolver.cached("localhost"));
+}
+
+TEST(Resolver, endScope) {
+    Resolver resolver{1};
+
+    std::atomic<int> invocations{0};
+
+    // occupy the only thread so that the next lookup is still pending when its scope ends
+    Resolver::TaskScope busyScope;
+    resolver.resolve(busyScope, "localhost", [&](std::vector<Address> addresses) {
+        std::this_thread::sleep_for(100ms);
+        ++invocations;
+    });
+
+    {
+        Resolver::TaskScope scope;
+        resolver.resolve(scope, "localhost.localdomain", [&](std::vector<Address> addresses) {
+            ++invocations;
+        });
+    }
+
+    std::this_thread::sleep_for(200ms);
+    EXPECT_EQ(invocations, 1);
+}
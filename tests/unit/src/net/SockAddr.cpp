@@ -0,0 +1,77 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "../gtest.h"
+
+#include <scraps/net/SockAddr.h>
+
+#include <unordered_set>
+
+using namespace scraps;
+using namespace scraps::net;
+
+TEST(SockAddr, endpointConversion) {
+    for (auto& endpoint : {
+        Endpoint{Address::from_string("127.0.0.1"), 8080},
+        Endpoint{Address::from_string("::1"), 8080},
+        Endpoint{Address::from_string("fe80::1%1"), 1},
+    }) {
+        SockAddr address{endpoint};
+        EXPECT_EQ(address.endpoint(), endpoint);
+        EXPECT_EQ(address.address(), endpoint.address());
+        EXPECT_EQ(address.port(), endpoint.port());
+        EXPECT_EQ(address.isV4(), endpoint.address().is_v4());
+        EXPECT_EQ(address.isV6(), endpoint.address().is_v6());
+        EXPECT_FALSE(address.empty());
+    }
+
+    EXPECT_TRUE(SockAddr{}.empty());
+    EXPECT_EQ(SockAddr{}.length(), 0);
+}
+
+TEST(SockAddr, nativeConversion) {
+    Endpoint endpoint{Address::from_string("127.0.0.1"), 8080};
+
+    sockaddr_storage storage;
+    socklen_t length;
+    endpoint.getSockAddr(&storage, &length);
+
+    // addresses received from the kernel compare equal to converted ones
+    SockAddr address{reinterpret_cast<sockaddr*>(&storage), length};
+    EXPECT_EQ(address, SockAddr{endpoint});
+    EXPECT_EQ(address.length(), length);
+    EXPECT_EQ(memcmp(address.native(), &storage, length), 0);
+
+    // other families aren't supported
+    memset(&storage, 0, sizeof(storage));
+    storage.ss_family = AF_UNSPEC;
+    EXPECT_TRUE((SockAddr{reinterpret_cast<sockaddr*>(&storage), sizeof(storage)}.empty()));
+}
+
+TEST(SockAddr, hash) {
+    std::unordered_set<SockAddr> addresses;
+    for (uint16_t port = 1; port <= 100; ++port) {
+        addresses.emplace(Address::from_string("127.0.0.1"), port);
+        addresses.emplace(Address::from_string("::1"), port);
+    }
+    EXPECT_EQ(addresses.size(), 200);
+
+    SockAddr a{Address::from_string("10.0.0.1"), 80}, b{Address::from_string("10.0.0.1"), 80}, c{Address::from_string("10.0.0.1"), 81};
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_NE(a, c);
+    EXPECT_NE(a.hash(), c.hash());
+    EXPECT_EQ(addresses.count(SockAddr{Address::from_string("::1"), 50}), 1);
+}
@@ -17,6 +17,12 @@
 
 #include <scraps/net/TCPService.h>
 
+#include <algorithm>
+#include <future>
+#include <set>
+
+#include <unistd.h>
+
 using namespace scraps;
 using namespace scraps::net;
 
@@ -90,3 +96,737 @@ TEST(TCPService, failedConnection) {
     EXPECT_EQ(delegate.received, 0);
     EXPECT_EQ(delegate.closed, 0);
 }
+
+TEST(TCPService, staleConnectionIds) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            ids.insert(connectionId);
+            ++established;
+        }
+
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            this->data.append(static_cast<const char*>(data), length);
+        }
+
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override { ++closed; }
+
+        std::mutex mutex;
+        std::set<TCPService::ConnectionId> ids;
+        std::string data;
+        std::atomic<size_t> established{0}, closed{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    auto stale = service.connect("127.0.0.1", service.port());
+    for (int i = 0; i < 100 && delegate.established < 2; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    service.close(stale);
+    for (int i = 0; i < 100 && delegate.closed < 2; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    // the new connections reuse the closed connections' slots, but not their ids
+    auto connection = service.connect("127.0.0.1", service.port());
+    for (int i = 0; i < 100 && delegate.established < 4; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    service.send(stale, "stale");
+    service.send(connection, "fresh");
+
+    std::this_thread::sleep_for(200ms);
+
+    service.stop();
+    service.wait();
+
+    std::lock_guard<std::mutex> lock{delegate.mutex};
+    EXPECT_EQ(delegate.ids.size(), 4);
+    EXPECT_EQ(delegate.data, "fresh");
+}
+
+TEST(TCPService, cancelAsync) {
+    CountingDelegate delegate;
+    TCPService service{&delegate};
+    service.start();
+
+    std::atomic<int> invocations{0};
+    auto cancelled = service.async([&] { ++invocations; }, 100ms);
+    auto rescheduled = service.async([&] { ++invocations; }, 10s);
+
+    EXPECT_TRUE(cancelled.cancel());
+    EXPECT_TRUE(rescheduled.reschedule(50ms));
+
+    std::this_thread::sleep_for(300ms);
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(invocations, 1);
+}
+
+TEST(TCPService, runLoopGroup) {
+    constexpr int kConnections = 16;
+
+    struct Delegate : CountingDelegate {
+        explicit Delegate(RunLoopGroup* group) : group{group} {}
+
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            EXPECT_TRUE(group->isCurrentThread());
+            threads.insert(std::this_thread::get_id());
+            CountingDelegate::tcpServiceConnectionEstablished(connectionId);
+        }
+
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            bytesReceived += length;
+        }
+
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            CountingDelegate::tcpServiceConnectionClosed(connectionId);
+        }
+
+        RunLoopGroup* const group;
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        size_t bytesReceived = 0;
+    };
+
+    RunLoopGroup group{4};
+    Delegate delegate{&group};
+    TCPService service{&delegate, &group};
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    ASSERT_GT(service.port(), 0);
+    service.start();
+
+    std::vector<TCPService::ConnectionId> connections;
+    for (int i = 0; i < kConnections; ++i) {
+        auto connection = service.connect("127.0.0.1", service.port());
+        EXPECT_GT(connection, 0);
+        connections.push_back(connection);
+    }
+
+    for (auto connection : connections) {
+        service.send(connection, "hello");
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{delegate.mutex};
+        if (delegate.bytesReceived == kConnections * 5) { break; }
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 2 * kConnections);
+    EXPECT_EQ(delegate.failed, 0);
+    EXPECT_EQ(delegate.bytesReceived, kConnections * 5);
+    EXPECT_EQ(delegate.closed, 2 * kConnections);
+
+    // both the outgoing and accepted connections are spread across the group
+    EXPECT_GT(delegate.threads.size(), 1);
+}
+
+TEST(TCPService, sharedBuffers) {
+    constexpr int kConnections = 8;
+
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            received.append(static_cast<const char*>(data), length);
+        }
+
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override {}
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override {}
+
+        std::mutex mutex;
+        std::string received;
+    };
+
+    RunLoopGroup group{2};
+    Delegate delegate;
+    TCPService service{&delegate, &group};
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    std::vector<TCPService::ConnectionId> connections;
+    for (int i = 0; i < kConnections; ++i) {
+        connections.push_back(service.connect("127.0.0.1", service.port()));
+    }
+
+    auto payload = std::make_shared<const std::string>("hello");
+    std::weak_ptr<const std::string> weakPayload = payload;
+    service.send(connections, std::move(payload));
+
+    static const char kWorld[] = "world";
+    std::atomic<bool> released{false};
+    service.send(connections[0], kWorld, 5, std::shared_ptr<const void>(kWorld, [&](const void*) { released = true; }));
+
+    const size_t expected = kConnections * 5 + 5;
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{delegate.mutex};
+        if (delegate.received.size() == expected) { break; }
+    }
+
+    EXPECT_TRUE(released);
+    EXPECT_TRUE(weakPayload.expired());
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.received.size(), expected);
+    EXPECT_EQ(std::count(delegate.received.begin(), delegate.received.end(), 'h'), kConnections);
+    EXPECT_NE(delegate.received.find("world"), std::string::npos);
+}
+
+TEST(TCPService, coalescedSends) {
+    constexpr int kMessages = 100;
+
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            bytesReceived += length;
+        }
+
+        std::atomic<size_t> bytesReceived{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    // these are all queued before the loop gets a chance to establish the connection, so they
+    // should go out together
+    service.async([&] {
+        auto connection = service.connect("127.0.0.1", service.port());
+        for (int i = 0; i < kMessages; ++i) {
+            service.send(connection, "hello");
+        }
+    });
+
+    for (int i = 0; i < 50 && delegate.bytesReceived < kMessages * 5; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.bytesReceived, kMessages * 5);
+
+    auto stats = service.stats();
+    EXPECT_EQ(stats.bytesSent, kMessages * 5);
+    EXPECT_EQ(stats.sendBuffers, kMessages);
+    EXPECT_LT(stats.sendCalls, kMessages / 2);
+}
+
+TEST(TCPService, receiveBuffers) {
+    constexpr size_t kLength = 256 * 1024;
+    static constexpr size_t kBudget = 4096;
+
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedBuffer(TCPService::ConnectionId connectionId, const std::shared_ptr<const void>& buffer, const void* data, size_t length) override {
+            EXPECT_LE(length, kBudget);
+            // retain every other buffer to make sure retained buffers aren't reused
+            std::lock_guard<std::mutex> lock{mutex};
+            if (chunks.size() % 2) {
+                chunks.emplace_back(buffer, std::string{});
+            } else {
+                chunks.emplace_back(nullptr, std::string(static_cast<const char*>(data), length));
+            }
+            pointers.emplace_back(static_cast<const char*>(data), length);
+            bytesReceived += length;
+        }
+
+        std::mutex mutex;
+        std::vector<std::pair<std::shared_ptr<const void>, std::string>> chunks;
+        std::vector<std::pair<const char*, size_t>> pointers;
+        size_t bytesReceived = 0;
+    } delegate;
+    TCPService service{&delegate};
+    service.setReceiveBudget(kBudget);
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    std::string payload(kLength, 0);
+    for (size_t i = 0; i < kLength; ++i) {
+        payload[i] = static_cast<char>(i * 7 + i / 256);
+    }
+
+    auto connection = service.connect("127.0.0.1", service.port());
+    service.send(connection, payload);
+
+    for (int i = 0; i < 100; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{delegate.mutex};
+        if (delegate.bytesReceived == kLength) { break; }
+    }
+
+    service.stop();
+    service.wait();
+
+    std::string received;
+    for (size_t i = 0; i < delegate.chunks.size(); ++i) {
+        if (delegate.chunks[i].first) {
+            received.append(delegate.pointers[i].first, delegate.pointers[i].second);
+        } else {
+            received.append(delegate.chunks[i].second);
+        }
+    }
+    EXPECT_TRUE(received == payload);
+
+    auto stats = service.stats();
+    EXPECT_EQ(stats.bytesReceived, kLength);
+    EXPECT_GE(stats.receiveCalls, kLength / kBudget);
+    EXPECT_GT(stats.receiveBudgetExhausted, 0);
+    EXPECT_GE(stats.receiveWakeups, kLength / kBudget);
+}
+
+TEST(TCPService, zeroReceiveBudget) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            bytesReceived += length;
+        }
+
+        std::atomic<size_t> bytesReceived{0};
+    } delegate;
+    TCPService service{&delegate};
+    service.setReceiveBudget(0);
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    service.send(service.connect("127.0.0.1", service.port()), "hello");
+
+    for (int i = 0; i < 50 && delegate.bytesReceived < 5; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    // the budget is clamped to a byte per wakeup rather than never reading
+    EXPECT_EQ(delegate.bytesReceived, 5);
+    EXPECT_GE(service.stats().receiveCalls, 5);
+}
+
+TEST(TCPService, backpressure) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            bytesReceived += length;
+        }
+
+        virtual void tcpServiceConnectionBackpressure(TCPService::ConnectionId connectionId) override {
+            ++backpressured;
+        }
+
+        virtual void tcpServiceConnectionWritable(TCPService::ConnectionId connectionId) override {
+            ++writable;
+        }
+
+        std::atomic<size_t> bytesReceived{0};
+        std::atomic<int> backpressured{0};
+        std::atomic<int> writable{0};
+    } delegate;
+    TCPService service{&delegate};
+    service.setSendQueueWaterMarks(1000, 10000);
+    service.setMaxQueuedBytes(50000);
+
+    EXPECT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    std::string chunk(5000, 'x');
+
+    // queue everything before the connection is established so that it can't drain
+    std::atomic<int> accepted{0};
+    std::atomic<int> rejected{0};
+    service.async([&] {
+        auto connection = service.connect("127.0.0.1", service.port());
+        for (int i = 0; i < 20; ++i) {
+            if (service.send(connection, chunk)) {
+                ++accepted;
+            } else {
+                ++rejected;
+            }
+        }
+    });
+
+    for (int i = 0; i < 50 && delegate.writable < 1; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    EXPECT_EQ(accepted, 10);
+    EXPECT_EQ(rejected, 10);
+    EXPECT_EQ(delegate.backpressured, 1);
+    EXPECT_EQ(delegate.writable, 1);
+
+    for (int i = 0; i < 50 && delegate.bytesReceived < 50000; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    auto stats = service.stats();
+    EXPECT_EQ(stats.bytesQueued, 0);
+    EXPECT_EQ(stats.sendsRejected, 10);
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.bytesReceived, 50000);
+}
+
+TEST(TCPService, acceptBatching) {
+    constexpr size_t kConnections = 200;
+
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+
+        std::atomic<size_t> established{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    EXPECT_TRUE(service.bind("127.0.0.1", 0, 512));
+    service.start();
+
+    service.async([&] {
+        for (size_t i = 0; i < kConnections; ++i) {
+            service.connect("127.0.0.1", service.port());
+        }
+    });
+
+    for (int i = 0; i < 100 && delegate.established < 2 * kConnections; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    auto stats = service.stats();
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 2 * kConnections);
+    EXPECT_EQ(stats.connectionsAccepted, kConnections);
+    EXPECT_EQ(stats.acceptErrors, 0);
+    EXPECT_GT(stats.acceptWakeups, 0);
+    EXPECT_LE(stats.acceptWakeups, kConnections);
+}
+
+TEST(TCPService, ipv6) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override { bytesReceived += length; }
+
+        std::atomic<size_t> established{0};
+        std::atomic<size_t> bytesReceived{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    // dual-stack, so both of the connections below should be accepted
+    ASSERT_TRUE(service.bind("::"));
+    ASSERT_GT(service.port(), 0);
+    service.start();
+
+    service.send(service.connect("::1", service.port()), "hello");
+    service.send(service.connect("127.0.0.1", service.port()), "hello");
+
+    for (int i = 0; i < 50 && delegate.bytesReceived < 10; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 4);
+    EXPECT_EQ(delegate.bytesReceived, 10);
+    EXPECT_EQ(service.stats().connectionsAccepted, 2);
+}
+
+TEST(TCPService, hostname) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+
+        std::atomic<size_t> established{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    auto resolver = std::make_shared<Resolver>();
+    service.setResolver(resolver);
+
+    ASSERT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    service.connect("localhost", service.port());
+
+    for (int i = 0; i < 50 && delegate.established < 2; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    EXPECT_EQ(delegate.established, 2);
+    EXPECT_TRUE(resolver->cached("localhost"));
+
+    // this one should be resolved from the cache
+    service.connect("localhost", service.port());
+
+    for (int i = 0; i < 50 && delegate.established < 4; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 4);
+}
+
+TEST(TCPService, hostnameFallback) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+        virtual void tcpServiceConnectionFailed(TCPService::ConnectionId connectionId) override { ++failed; }
+
+        std::atomic<size_t> established{0};
+        std::atomic<size_t> failed{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    auto resolver = std::make_shared<Resolver>();
+    service.setResolver(resolver);
+
+    Resolver::TaskScope scope;
+    std::promise<std::vector<Address>> promise;
+    resolver->resolve(scope, "localhost", [&](std::vector<Address> addresses) { promise.set_value(std::move(addresses)); });
+    auto addresses = promise.get_future().get();
+    if (std::none_of(addresses.begin(), addresses.end(), [](auto& address) { return address.is_v4(); })
+        || std::none_of(addresses.begin(), addresses.end(), [](auto& address) { return address.is_v6(); })) {
+        // only meaningful where localhost resolves to both families
+        return;
+    }
+
+    // the ipv4 address is tried first and refused, so the connection has to fall back to ipv6
+    ASSERT_TRUE(service.bind("::1"));
+    service.start();
+
+    service.connect("localhost", service.port());
+
+    for (int i = 0; i < 50 && delegate.established < 2; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 2);
+    EXPECT_EQ(delegate.failed, 0);
+}
+
+TEST(TCPService, droppedConnects) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+        virtual void tcpServiceConnectionFailed(TCPService::ConnectionId connectionId) override { ++failed; }
+
+        std::atomic<size_t> established{0};
+        std::atomic<size_t> failed{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    auto resolver = std::make_shared<Resolver>();
+    service.setResolver(resolver);
+
+    // warm the cache so that connecting to the hostname queues its work immediately
+    Resolver::TaskScope scope;
+    std::promise<void> promise;
+    resolver->resolve(scope, "localhost", [&](std::vector<Address> addresses) { promise.set_value(); });
+    promise.get_future().wait();
+
+    ASSERT_TRUE(service.bind("127.0.0.1"));
+
+    // the loop isn't running yet, so these are dropped when it starts
+    std::set<TCPService::ConnectionId> dropped{service.connect("127.0.0.1", service.port()), service.connect("localhost", service.port())};
+
+    service.start();
+
+    EXPECT_EQ(delegate.failed, 2);
+
+    // the dropped connections' slots are free again, but their ids aren't
+    std::set<TCPService::ConnectionId> droppedSlots, slots;
+    for (auto id : dropped) {
+        droppedSlots.insert(id & 0xffffffff);
+    }
+    std::vector<TCPService::ConnectionId> connections;
+    std::promise<void> connected;
+    // reserved by the loop so that accepted connections can't take the slots in between
+    service.async([&] {
+        for (int i = 0; i < 2; ++i) {
+            connections.push_back(service.connect("127.0.0.1", service.port()));
+        }
+        connected.set_value();
+    });
+    connected.get_future().wait();
+    for (auto connection : connections) {
+        EXPECT_EQ(dropped.count(connection), 0);
+        slots.insert(connection & 0xffffffff);
+    }
+    EXPECT_EQ(slots, droppedSlots);
+
+    for (int i = 0; i < 50 && delegate.established < 4; ++i) {
+        std::this_thread::sleep_for(20ms);
+    }
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(delegate.established, 4);
+    EXPECT_EQ(delegate.failed, 2);
+}
+
+TEST(TCPService, idleTimeout) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionReceivedData(TCPService::ConnectionId connectionId, const void* data, size_t length) override {
+            if (!isEchoing.exchange(true)) {
+                // the accepted end echoes back so that both ends stay active
+                service->send(connectionId, data, length);
+            }
+        }
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override { ++closed; }
+        virtual void tcpServiceConnectionTimedOut(TCPService::ConnectionId connectionId) override {
+            std::lock_guard<std::mutex> lock{mutex};
+            timedOut.insert(connectionId);
+        }
+
+        TCPService* service = nullptr;
+        std::atomic<bool> isEchoing{false};
+        std::atomic<size_t> closed{0};
+        std::mutex mutex;
+        std::set<TCPService::ConnectionId> timedOut;
+    } delegate;
+    TCPService service{&delegate};
+    delegate.service = &service;
+
+    service.setIdleReadTimeout(200ms);
+    ASSERT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    auto active = service.connect("127.0.0.1", service.port());
+    service.connect("127.0.0.1", service.port());
+
+    for (int i = 0; i < 12; ++i) {
+        service.send(active, "ping");
+        std::this_thread::sleep_for(50ms);
+        delegate.isEchoing = false;
+    }
+
+    auto stats = service.stats();
+    size_t closed = delegate.closed;
+
+    service.stop();
+    service.wait();
+
+    // only the idle connection and its peer are closed
+    EXPECT_EQ(closed, 2);
+    EXPECT_GE(stats.connectionsTimedOut, 1);
+    std::lock_guard<std::mutex> lock{delegate.mutex};
+    EXPECT_EQ(delegate.timedOut.count(active), 0);
+}
+
+TEST(TCPService, acceptLimits) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override { ++closed; }
+        virtual bool tcpServiceShouldAcceptConnection(const sockaddr* address, size_t addressLength) override {
+            EXPECT_EQ(address->sa_family, AF_INET);
+            return isAccepting;
+        }
+
+        std::atomic<bool> isAccepting{true};
+        std::atomic<size_t> established{0}, closed{0};
+    } delegate;
+    TCPService service{&delegate};
+
+    // the first connection and its peer use up the limit
+    service.setMaxConnections(2);
+    service.setKeepAlive(true, 60s, 10s, 3);
+    ASSERT_TRUE(service.bind("127.0.0.1"));
+    service.start();
+
+    service.connect("127.0.0.1", service.port());
+    for (int i = 0; i < 50 && delegate.established < 2; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    // refused by the limit, then by the delegate
+    service.connect("127.0.0.1", service.port());
+    for (int i = 0; i < 50 && service.stats().connectionsRejected < 1; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    service.setMaxConnections(10);
+    delegate.isAccepting = false;
+    service.connect("127.0.0.1", service.port());
+
+    for (int i = 0; i < 50 && service.stats().connectionsRejected < 2; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    auto stats = service.stats();
+
+    service.stop();
+    service.wait();
+
+    EXPECT_EQ(stats.connectionsAccepted, 1);
+    EXPECT_EQ(stats.connectionsRejected, 2);
+    // the refused connections are closed by their peer
+    EXPECT_EQ(delegate.closed, 4);
+}
+
+TEST(TCPService, idleWriteTimeout) {
+    struct Delegate : CountingDelegate {
+        virtual void tcpServiceConnectionEstablished(TCPService::ConnectionId connectionId) override { ++established; }
+        virtual void tcpServiceConnectionTimedOut(TCPService::ConnectionId connectionId) override { ++timedOut; }
+        virtual void tcpServiceConnectionClosed(TCPService::ConnectionId connectionId) override { ++closed; }
+
+        std::atomic<size_t> established{0}, timedOut{0}, closed{0};
+    } delegate;
+    TCPService service{&delegate};
+    service.setIdleWriteTimeout(200ms);
+    service.start();
+
+    // a peer that never reads
+    auto listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLength = sizeof(address);
+    ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&address), addressLength), 0);
+    ASSERT_EQ(::listen(listener, 1), 0);
+    ASSERT_EQ(::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &addressLength), 0);
+
+    auto connection = service.connect(reinterpret_cast<sockaddr*>(&address), addressLength);
+    for (int i = 0; i < 50 && !delegate.established; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    // far more than the socket buffers can hold
+    service.send(connection, std::make_shared<const std::string>(64 * 1024 * 1024, 'x'));
+
+    for (int i = 0; i < 100 && !delegate.closed; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+
+    auto stats = service.stats();
+
+    service.stop();
+    service.wait();
+    ::close(listener);
+
+    EXPECT_EQ(delegate.timedOut, 1);
+    EXPECT_EQ(delegate.closed, 1);
+    EXPECT_EQ(stats.connectionsTimedOut, 1);
+    EXPECT_EQ(stats.bytesQueued, 0);
+}
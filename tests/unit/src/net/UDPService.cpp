@@ -18,6 +18,8 @@
 #include <scraps/net/utility.h>
 #include <scraps/net/UDPService.h>
 
+#include <set>
+
 using namespace scraps;
 using namespace scraps::net;
 
@@ -196,3 +198,148 @@ TEST(UDPService, multicastIPv6) {
         MulticastTest(UDPSocket::Protocol::kIPv6);
     }
 };
+
+TEST(UDPService, runLoopGroup) {
+    constexpr int kSockets = 8;
+
+    RunLoopGroup group{4};
+    UDPService service{&group};
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    int received = 0;
+
+    auto receiver = std::make_shared<LambdaUDPReceiver>([&](const Endpoint& sender, const void* data, size_t len) {
+        std::lock_guard<std::mutex> lock{mutex};
+        EXPECT_TRUE(group.isCurrentThread());
+        threads.insert(std::this_thread::get_id());
+        ++received;
+    });
+
+    std::vector<std::shared_ptr<UDPSocket>> sockets;
+    for (int i = 0; i < kSockets; ++i) {
+        auto socket = service.openSocket(UDPSocket::Protocol::kIPv4, 10050 + i, receiver, "127.0.0.1");
+        ASSERT_TRUE(socket);
+        sockets.push_back(socket);
+    }
+
+    for (int i = 0; i < kSockets; ++i) {
+        ASSERT_TRUE(sockets[0]->send(Endpoint(Address::from_string("127.0.0.1"), 10050 + i), "hi", 2));
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (received == kSockets) { break; }
+    }
+
+    service.kill();
+
+    EXPECT_EQ(received, kSockets);
+    // the sockets are spread across the group
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(UDPService, socketGroup) {
+    constexpr int kSenders = 16;
+
+    RunLoopGroup group{4};
+    UDPService service{&group};
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    int received = 0;
+
+    auto receiver = std::make_shared<LambdaUDPReceiver>([&](const Endpoint& sender, const void* data, size_t len) {
+        std::lock_guard<std::mutex> lock{mutex};
+        EXPECT_TRUE(group.isCurrentThread());
+        threads.insert(std::this_thread::get_id());
+        ++received;
+    });
+
+    auto sockets = service.openSocketGroup(UDPSocket::Protocol::kIPv4, 0, receiver, "127.0.0.1");
+    ASSERT_EQ(sockets.size(), group.size());
+
+    auto port = sockets[0]->port();
+    ASSERT_NE(port, 0);
+    for (auto& socket : sockets) {
+        EXPECT_EQ(socket->port(), port);
+    }
+
+    // datagrams are distributed by source, so send from several ports
+    for (int i = 0; i < kSenders; ++i) {
+        UDPSocket sender{UDPSocket::Protocol::kIPv4};
+        ASSERT_TRUE(sender.bind("127.0.0.1", 10070 + i));
+        ASSERT_TRUE(sender.send(Endpoint(Address::from_string("127.0.0.1"), port), "hi", 2));
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (received == kSenders) { break; }
+    }
+
+    service.kill();
+
+    EXPECT_EQ(received, kSenders);
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(UDPService, openDuringDelivery) {
+    RunLoopGroup group{2};
+    UDPService service{&group};
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    int received = 0;
+
+    auto receiver = std::make_shared<LambdaUDPReceiver>([&](const Endpoint& sender, const void* data, size_t len) {
+        std::lock_guard<std::mutex> lock{mutex};
+        threads.insert(std::this_thread::get_id());
+        ++received;
+    });
+
+    // delivery holds no service locks, so receivers can open sockets
+    std::shared_ptr<UDPSocket> opened;
+    auto opener = std::make_shared<LambdaUDPReceiver>([&](const Endpoint& sender, const void* data, size_t len) {
+        auto socket = service.openSocket(UDPSocket::Protocol::kIPv4, 10081, receiver, "127.0.0.1");
+        std::lock_guard<std::mutex> lock{mutex};
+        opened = socket;
+    });
+
+    auto first = service.openSocket(UDPSocket::Protocol::kIPv4, 10080, opener, "127.0.0.1");
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(first->send(Endpoint(Address::from_string("127.0.0.1"), 10080), "hi", 2));
+
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (opened) { break; }
+    }
+
+    std::shared_ptr<UDPSocket> second;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        second = opened;
+    }
+    ASSERT_TRUE(second);
+
+    // the new socket went to the other loop, and replacing the first socket doesn't disturb it
+    first.reset();
+    auto third = service.openSocket(UDPSocket::Protocol::kIPv4, 10082, receiver, "127.0.0.1");
+    ASSERT_TRUE(third);
+
+    ASSERT_TRUE(third->send(Endpoint(Address::from_string("127.0.0.1"), 10081), "hi", 2));
+    ASSERT_TRUE(second->send(Endpoint(Address::from_string("127.0.0.1"), 10082), "hi", 2));
+
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(20ms);
+        std::lock_guard<std::mutex> lock{mutex};
+        if (received == 2) { break; }
+    }
+
+    service.kill();
+
+    EXPECT_EQ(received, 2);
+    EXPECT_EQ(threads.size(), 2);
+}
@@ -0,0 +1,279 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "../gtest.h"
+
+#include <scraps/net/UDPSocket.h>
+
+using namespace scraps;
+using namespace scraps::net;
+
+TEST(UDPSocket, batches) {
+    constexpr size_t kDatagrams = 100;
+
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override {
+            ADD_FAILURE() << "datagrams should be delivered in batches";
+        }
+
+        virtual void receiveUDPBatch(const Datagram* datagrams, size_t count) override {
+            ++batches;
+            for (size_t i = 0; i < count; ++i) {
+                EXPECT_EQ(datagrams[i].sender.port(), senderPort);
+                EXPECT_EQ(datagrams[i].length, sizeof(size_t));
+                size_t sequence;
+                memcpy(&sequence, datagrams[i].data, sizeof(sequence));
+                EXPECT_EQ(sequence, received++);
+            }
+        }
+
+        uint16_t senderPort = 0;
+        size_t batches = 0;
+        size_t received = 0;
+    };
+
+    auto receiver = std::make_shared<Receiver>();
+    UDPSocket sender{UDPSocket::Protocol::kIPv4};
+    UDPSocket receiverSocket{UDPSocket::Protocol::kIPv4, receiver};
+    ASSERT_TRUE(sender.bind("127.0.0.1", 10060));
+    ASSERT_TRUE(receiverSocket.bind("127.0.0.1", 10061));
+    receiver->senderPort = 10060;
+
+    std::vector<size_t> sequences(kDatagrams);
+    std::vector<UDPSender::Datagram> datagrams(kDatagrams);
+    Endpoint destination{Address::from_string("127.0.0.1"), 10061};
+    for (size_t i = 0; i < kDatagrams; ++i) {
+        sequences[i] = i;
+        datagrams[i].destination = destination;
+        datagrams[i].data = &sequences[i];
+        datagrams[i].length = sizeof(size_t);
+    }
+
+    EXPECT_EQ(sender.sendBatch(datagrams.data(), datagrams.size()), kDatagrams);
+    EXPECT_EQ(sender.totalSentBytes(), kDatagrams * sizeof(size_t));
+
+    for (int i = 0; i < 50 && receiver->received < kDatagrams; ++i) {
+        receiverSocket.receive();
+        std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_EQ(receiver->received, kDatagrams);
+    EXPECT_EQ(receiverSocket.totalReceivedBytes(), kDatagrams * sizeof(size_t));
+    EXPECT_LT(receiver->batches, kDatagrams);
+}
+
+TEST(UDPSocket, segmentationOffload) {
+    constexpr size_t kDatagrams = 100;
+    constexpr size_t kLength = 1000;
+
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override {
+            auto bytes = static_cast<const unsigned char*>(data);
+            // the last datagram is shorter
+            EXPECT_EQ(length, received == kDatagrams - 1 ? kLength / 2 : kLength);
+            EXPECT_EQ(bytes[0], received % 256);
+            EXPECT_EQ(bytes[length - 1], received % 256);
+            ++received;
+        }
+
+        size_t received = 0;
+    };
+
+    auto receiver = std::make_shared<Receiver>();
+    UDPSocket sender{UDPSocket::Protocol::kIPv4};
+    UDPSocket receiverSocket{UDPSocket::Protocol::kIPv4, receiver};
+    ASSERT_TRUE(sender.bind("127.0.0.1", 10062));
+    ASSERT_TRUE(receiverSocket.bind("127.0.0.1", 10063));
+
+    // either way, the datagrams should arrive intact
+    sender.setSegmentationOffload(true);
+    receiverSocket.setSegmentationOffload(true);
+
+    std::vector<std::vector<unsigned char>> payloads;
+    std::vector<UDPSender::Datagram> datagrams(kDatagrams);
+    Endpoint destination{Address::from_string("127.0.0.1"), 10063};
+    for (size_t i = 0; i < kDatagrams; ++i) {
+        payloads.emplace_back(i == kDatagrams - 1 ? kLength / 2 : kLength, static_cast<unsigned char>(i));
+        datagrams[i].destination = destination;
+        datagrams[i].data = payloads.back().data();
+        datagrams[i].length = payloads.back().size();
+    }
+
+    EXPECT_EQ(sender.sendBatch(datagrams.data(), datagrams.size()), kDatagrams);
+
+    for (int i = 0; i < 50 && receiver->received < kDatagrams; ++i) {
+        receiverSocket.receive();
+        std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_EQ(receiver->received, kDatagrams);
+    EXPECT_EQ(receiverSocket.totalReceivedBytes(), (kDatagrams - 1) * kLength + kLength / 2);
+}
+
+TEST(UDPSocket, retainedBuffers) {
+    constexpr size_t kDatagrams = 3 * UDPSocket::kMaxPooledReceiveBuffers;
+
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override {
+            ADD_FAILURE() << "datagrams should be delivered in batches";
+        }
+
+        virtual void receiveUDPBatch(const Datagram* datagrams, size_t count) override {
+            // keep every other datagram without copying it
+            for (size_t i = 0; i < count; ++i, ++received) {
+                if (received % 2 == 0) {
+                    retained.emplace_back(datagrams[i]);
+                }
+            }
+        }
+
+        std::vector<Datagram> retained;
+        size_t received = 0;
+    };
+
+    auto receiver = std::make_shared<Receiver>();
+    UDPSocket sender{UDPSocket::Protocol::kIPv4};
+    UDPSocket receiverSocket{UDPSocket::Protocol::kIPv4, receiver};
+    ASSERT_TRUE(sender.bind("127.0.0.1", 10064));
+    ASSERT_TRUE(receiverSocket.bind("127.0.0.1", 10065));
+
+    Endpoint destination{Address::from_string("127.0.0.1"), 10065};
+    for (size_t i = 0; i < kDatagrams; ++i) {
+        ASSERT_TRUE(sender.send(destination, &i, sizeof(i)));
+        if (i % UDPSocket::kBatchSize == UDPSocket::kBatchSize - 1) {
+            // don't overrun the socket's receive buffer
+            receiverSocket.receive();
+        }
+    }
+
+    for (int i = 0; i < 50 && receiver->received < kDatagrams; ++i) {
+        receiverSocket.receive();
+        std::this_thread::sleep_for(1ms);
+    }
+
+    ASSERT_EQ(receiver->received, kDatagrams);
+    ASSERT_EQ(receiver->retained.size(), kDatagrams / 2);
+
+    // released buffers were reused, but none of the retained ones were overwritten
+    for (size_t i = 0; i < receiver->retained.size(); ++i) {
+        auto& datagram = receiver->retained[i];
+        ASSERT_EQ(datagram.length, sizeof(size_t));
+        EXPECT_GE(datagram.buffer.use_count(), 1);
+        size_t sequence;
+        memcpy(&sequence, datagram.data, sizeof(sequence));
+        EXPECT_EQ(sequence, 2 * i);
+    }
+}
+
+TEST(UDPSocket, concurrentSendAndClose) {
+    constexpr int kThreads = 4;
+
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override { ++received; }
+        std::atomic<size_t> received{0};
+    };
+
+    auto receiver = std::make_shared<Receiver>();
+    UDPSocket socket{UDPSocket::Protocol::kIPv4, receiver};
+    ASSERT_TRUE(socket.bind("127.0.0.1", 10066));
+
+    SockAddr destination{Address::from_string("127.0.0.1"), 10066};
+
+    // senders share the socket with a receiving thread until it's closed out from under them
+    std::atomic<size_t> sent{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&, i] {
+            while (socket.send(destination, "hi", 2)) {
+                ++sent;
+                if (i == 0) { socket.receive(); }
+            }
+        });
+    }
+
+    while (sent < 1000 || !receiver->received) {
+        std::this_thread::yield();
+    }
+    socket.close();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LT(socket.native(), 0);
+    EXPECT_FALSE(socket.send(Endpoint{Address::from_string("127.0.0.1"), 10066}, "hi", 2));
+    EXPECT_GT(receiver->received, 0);
+}
+
+TEST(UDPSocket, receiveMetadata) {
+    struct Receiver : UDPReceiver {
+        virtual void receiveUDP(const Endpoint& sender, const void* data, size_t length) override {
+            ADD_FAILURE() << "datagrams should be delivered in batches";
+        }
+
+        virtual void receiveUDPBatch(const Datagram* datagrams, size_t count) override {
+            this->datagrams.insert(this->datagrams.end(), datagrams, datagrams + count);
+        }
+
+        std::vector<Datagram> datagrams;
+    };
+
+    for (auto protocol : {UDPSocket::Protocol::kIPv4, UDPSocket::Protocol::kIPv6}) {
+        auto loopback = Address::from_string(protocol == UDPSocket::Protocol::kIPv4 ? "127.0.0.1" : "::1");
+
+        auto receiver = std::make_shared<Receiver>();
+        UDPSocket sender{protocol};
+        UDPSocket receiverSocket{protocol, receiver};
+        ASSERT_TRUE(sender.bind(loopback.to_string().c_str(), 10067));
+        // bound to any interface, so the destination is only known via metadata
+        ASSERT_TRUE(receiverSocket.bind(10068));
+
+        if (!receiverSocket.setReceiveMetadata(true)) {
+            // not supported on this platform
+            continue;
+        }
+        EXPECT_TRUE(receiverSocket.isReceiveMetadataEnabled());
+
+        // mark the datagrams as ECN-capable (ECT(0))
+        int trafficClass = 0x2;
+        if (protocol == UDPSocket::Protocol::kIPv4) {
+            setsockopt(sender.native(), IPPROTO_IP, IP_TOS, &trafficClass, sizeof(trafficClass));
+        } else {
+            setsockopt(sender.native(), IPPROTO_IPV6, IPV6_TCLASS, &trafficClass, sizeof(trafficClass));
+        }
+
+        // the kernel enables timestamping asynchronously
+        std::this_thread::sleep_for(20ms);
+
+        auto before = std::chrono::steady_clock::now();
+        ASSERT_TRUE(sender.send(Endpoint{loopback, 10068}, "hi", 2));
+
+        // queue up the datagram for a while before reading it
+        std::this_thread::sleep_for(50ms);
+        for (int i = 0; i < 50 && receiver->datagrams.empty(); ++i) {
+            receiverSocket.receive();
+            std::this_thread::sleep_for(1ms);
+        }
+        auto after = std::chrono::steady_clock::now();
+
+        ASSERT_EQ(receiver->datagrams.size(), 1);
+        auto& datagram = receiver->datagrams[0];
+        EXPECT_EQ(datagram.destination, loopback);
+        EXPECT_EQ(datagram.ecn, 0x2);
+        EXPECT_GE(datagram.timestamp, before);
+        // the kernel stamped the datagram when it arrived, not when it was read
+        EXPECT_LT(datagram.timestamp, after - 25ms);
+    }
+}
@@ -0,0 +1,179 @@
+/**
+* Copyright 2016 BitTorrent Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "../gtest.h"
+
+#include <scraps/poller/EpollPoller.h>
+#include <scraps/poller/IOUringPoller.h>
+#include <scraps/poller/PollPoller.h>
+
+#include <array>
+#include <unordered_set>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace scraps;
+using namespace scraps::poller;
+
+namespace {
+
+short EventsFor(const std::vector<Event>& events, int fd) {
+    short ret = 0;
+    for (auto& event : events) {
+        if (event.fd == fd) {
+            ret |= event.events;
+        }
+    }
+    return ret;
+}
+
+void BasicTest(PollerInterface* poller) {
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+
+    std::vector<Event> events;
+
+    // nothing is ready yet
+    ASSERT_TRUE(poller->set(sockets[0], POLLIN));
+    ASSERT_TRUE(poller->set(sockets[1], POLLIN));
+    ASSERT_TRUE(poller->wait(&events, 0ms));
+    EXPECT_TRUE(events.empty());
+
+    // readiness is reported
+    ASSERT_EQ(send(sockets[0], "hi", 2, 0), 2);
+    events.clear();
+    ASSERT_TRUE(poller->wait(&events, 1s));
+    EXPECT_EQ(EventsFor(events, sockets[0]), 0);
+    EXPECT_EQ(EventsFor(events, sockets[1]), POLLIN);
+
+    // readiness is level-triggered
+    events.clear();
+    ASSERT_TRUE(poller->wait(&events, 1s));
+    EXPECT_EQ(EventsFor(events, sockets[1]), POLLIN);
+
+    // modifying the events takes effect
+    ASSERT_TRUE(poller->set(sockets[1], POLLIN | POLLOUT));
+    events.clear();
+    ASSERT_TRUE(poller->wait(&events, 1s));
+    EXPECT_EQ(EventsFor(events, sockets[1]), POLLIN | POLLOUT);
+
+    // removed descriptors aren't reported
+    poller->remove(sockets[1]);
+    events.clear();
+    ASSERT_TRUE(poller->wait(&events, 0ms));
+    EXPECT_EQ(EventsFor(events, sockets[1]), 0);
+
+    // removing twice is harmless
+    poller->remove(sockets[1]);
+    poller->remove(sockets[0]);
+
+    // hang ups are reported even if not requested
+    ASSERT_TRUE(poller->set(sockets[1], 0));
+    close(sockets[0]);
+    events.clear();
+    ASSERT_TRUE(poller->wait(&events, 1s));
+    EXPECT_TRUE(EventsFor(events, sockets[1]) & POLLHUP);
+
+    poller->remove(sockets[1]);
+    close(sockets[1]);
+}
+
+void ManyDescriptorsTest(PollerInterface* poller) {
+    constexpr int kPairs = 300;
+
+    std::vector<std::array<int, 2>> pairs(kPairs);
+    for (auto& pair : pairs) {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair.data()), 0);
+        ASSERT_TRUE(poller->set(pair[1], POLLIN));
+    }
+
+    for (int i = 0; i < kPairs; i += 3) {
+        ASSERT_EQ(send(pairs[i][0], "x", 1, 0), 1);
+    }
+
+    // every ready descriptor is eventually reported, even if it takes multiple waits
+    std::vector<Event> events;
+    std::unordered_set<int> ready;
+    for (int i = 0; i < 10 && ready.size() < (kPairs + 2) / 3; ++i) {
+        events.clear();
+        ASSERT_TRUE(poller->wait(&events, 1s));
+        for (auto& event : events) {
+            EXPECT_EQ(event.events, POLLIN);
+            ready.insert(event.fd);
+        }
+    }
+
+    EXPECT_EQ(ready.size(), (kPairs + 2) / 3);
+    for (int i = 0; i < kPairs; ++i) {
+        EXPECT_EQ(ready.count(pairs[i][1]), i % 3 == 0 ? 1 : 0);
+    }
+
+    for (auto& pair : pairs) {
+        poller->remove(pair[1]);
+        close(pair[0]);
+        close(pair[1]);
+    }
+}
+
+} // anonymous namespace
+
+TEST(PollPoller, basics) {
+    PollPoller poller;
+    BasicTest(&poller);
+}
+
+TEST(PollPoller, manyDescriptors) {
+    PollPoller poller;
+    ManyDescriptorsTest(&poller);
+}
+
+#if SCRAPS_LINUX || SCRAPS_ANDROID
+
+TEST(EpollPoller, basics) {
+    auto poller = EpollPoller::Create();
+    ASSERT_TRUE(poller);
+    BasicTest(poller.get());
+}
+
+TEST(EpollPoller, manyDescriptors) {
+    auto poller = EpollPoller::Create();
+    ASSERT_TRUE(poller);
+    ManyDescriptorsTest(poller.get());
+}
+
+#endif
+
+#if SCRAPS_IO_URING
+
+TEST(IOUringPoller, basics) {
+    auto poller = IOUringPoller::Create();
+    if (!poller) {
+        fprintf(stderr, "io_uring isn't available. skipping test.\n");
+        return;
+    }
+    BasicTest(poller.get());
+}
+
+TEST(IOUringPoller, manyDescriptors) {
+    auto poller = IOUringPoller::Create(32);
+    if (!poller) {
+        fprintf(stderr, "io_uring isn't available. skipping test.\n");
+        return;
+    }
+    ManyDescriptorsTest(poller.get());
+}
+
+#endif